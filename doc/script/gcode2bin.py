@@ -0,0 +1,260 @@
+#!/usr/bin/env python3
+"""\
+
+Convert g-code to grbl binary blocks
+
+Blocks made of plain words, the bulk of CAM output, are converted
+to binary blocks. Grbl decodes these without the character scanner
+and passes the words to the g-code parser as if read from text, so
+validation and execution are unchanged. Any other line is written
+as filtered text: without spaces and comments and upcased, as grbl
+would see it. Lines within O-word subroutines and loops are always
+written as text since they are replayed by grbl.
+
+A binary block is a line starting with '&', followed by sextets
+encoded as the characters 0x40 + value ('>' for 62, since '~' is a
+realtime command). Numbers are variable length, 5 bits per sextet
+with bit 5 set if more follow, signed numbers are zigzag coded.
+A word is a tag, the letter index (A = 0) plus 0x20 if delta coded,
+followed by either zigzag(mantissa) << 3 | decimals or the zigzag
+coded mantissa delta from the previous word with the same letter.
+Tag 26 repeats the letters of the previous binary block, followed
+by the mantissa deltas only. See grbl/gcode_binary.c.
+
+The first word of each letter is always absolute, so the output
+does not depend on earlier streams and may be stored with $FW.
+The output is streamed as any other g-code file, e.g. with
+stream.py. Grbl must be built with GCODE_BINARY_BLOCKS, reported
+as 'B' in the [OPT:] line of $I.
+
+Usage: gcode2bin.py [-o out.nc] [-s] [-c] in.nc
+
+  -s  print input and output sizes
+  -c  decode the output and verify it against the input
+
+---------------------
+The MIT License (MIT)
+
+Copyright (c) 2017 Terje Io
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+---------------------
+"""
+
+import argparse
+import re
+import sys
+
+PREFIX = '&'
+TAG_REPEAT = 26
+TAG_DELTA = 0x20
+MORE = 0x20
+MAX_DIGITS = 8       # As read_float() in grbl
+MAX_DECIMALS = 7
+MAX_WORDS = 32       # GC_BINARY_MAX_WORDS
+
+WORD = re.compile(r'([A-Z])([-+]?)(\d*)(?:\.(\d*))?')
+OWORD = re.compile(r'O\d+(SUB|ENDSUB|WHILE|ENDWHILE|DO|REPEAT|ENDREPEAT)?')
+
+
+def filter_line(line):
+    """Removes spaces, control characters and comments and upcases, as grbl's protocol does."""
+    out = []
+    comment = False
+    for c in line:
+        if comment:
+            comment = c != ')'
+        elif c == '(':
+            comment = True
+        elif c == ';':
+            break
+        elif c > ' ':
+            out.append(c.upper())
+    return ''.join(out)
+
+
+def parse_words(line):
+    """Returns the words of the line as (letter, mantissa, decimals), None if not plain words."""
+    words = []
+    pos = 0
+    while pos < len(line):
+        m = WORD.match(line, pos)
+        if m is None:
+            return None
+        letter, sign, whole, frac = m.group(1), m.group(2), m.group(3), m.group(4) or ''
+        if not whole and not frac or len(whole) + len(frac) > MAX_DIGITS or len(frac) > MAX_DECIMALS:
+            return None
+        mantissa = int(whole + frac)
+        words.append((letter, -mantissa if sign == '-' else mantissa, len(frac)))
+        pos = m.end()
+    return words if 0 < len(words) <= MAX_WORDS else None
+
+
+def sextet(value):
+    return '>' if value == 62 else chr(0x40 + value)
+
+
+def number(value):
+    out = ''
+    while value > 0x1F:
+        out += sextet((value & 0x1F) | MORE)
+        value >>= 5
+    return out + sextet(value)
+
+
+def zigzag(value):
+    return value << 1 if value >= 0 else ((-value) << 1) - 1
+
+
+def unzigzag(value):
+    return (value >> 1) ^ -(value & 1)
+
+
+class Encoder(object):
+
+    def __init__(self):
+        self.values = {}   # letter: (mantissa, decimals)
+        self.letters = []  # letters of the previous block
+
+    def encode(self, words):
+        """Returns the binary block and the state after it, the state is kept by commit()."""
+        values = dict(self.values)
+        block = ''
+        repeat = [w[0] for w in words] == self.letters
+        deltas = ''
+        for letter, mantissa, decimals in words:
+            absolute = sextet(ord(letter) - ord('A')) + number(zigzag(mantissa) << 3 | decimals)
+            if letter in values and values[letter][1] == decimals:
+                delta = number(zigzag(mantissa - values[letter][0]))
+                deltas += delta
+                delta = sextet((ord(letter) - ord('A')) | TAG_DELTA) + delta
+                block += delta if len(delta) <= len(absolute) else absolute
+            else:
+                repeat = False
+                block += absolute
+            values[letter] = (mantissa, decimals)
+        if repeat and len(deltas) + 1 < len(block):
+            block = sextet(TAG_REPEAT) + deltas
+        return PREFIX + block, (values, [w[0] for w in words])
+
+    def commit(self, state):
+        self.values, self.letters = state
+
+
+class Decoder(object):
+    """Mirrors gc_binary_decode(), used to verify the output."""
+
+    def __init__(self):
+        self.values = {}
+        self.letters = []
+
+    def decode(self, line):
+        codes = [62 if c == '>' else ord(c) - 0x40 for c in line[1:]]
+        pos = 0
+        words = []
+        repeat = False
+
+        def read_number():
+            nonlocal pos
+            value = shift = 0
+            while True:
+                code = codes[pos]
+                pos += 1
+                value |= (code & 0x1F) << shift
+                shift += 5
+                if not code & MORE:
+                    return value
+
+        while pos < len(codes):
+            if repeat:
+                letter, delta = self.letters[len(words)], True
+            else:
+                tag = codes[pos]
+                pos += 1
+                if tag == TAG_REPEAT and not words:
+                    repeat = True
+                    continue
+                letter, delta = chr(ord('A') + (tag & ~TAG_DELTA)), bool(tag & TAG_DELTA)
+            value = read_number()
+            if delta:
+                mantissa, decimals = self.values[letter]
+                mantissa += unzigzag(value)
+            else:
+                mantissa, decimals = unzigzag(value >> 3), value & 0x07
+            self.values[letter] = (mantissa, decimals)
+            words.append((letter, mantissa, decimals))
+        self.letters = [w[0] for w in words]
+        return words
+
+
+def convert(lines):
+    """Yields (text, output) for each non-empty line."""
+    encoder = Encoder()
+    stack = []  # Open O-word subroutines and loops
+    for raw in lines:
+        text = filter_line(raw)
+        if not text:
+            continue
+        oword = OWORD.match(text)
+        if oword:
+            keyword = oword.group(1)
+            if keyword in ('SUB', 'DO', 'REPEAT') or keyword == 'WHILE' and (not stack or stack[-1] != 'DO'):
+                stack.append(keyword)
+            elif keyword in ('ENDSUB', 'ENDWHILE', 'ENDREPEAT', 'WHILE') and stack:
+                stack.pop()
+            yield text, text
+            continue
+        words = None if stack or text[0] in '$/%' else parse_words(text)
+        if words is not None:
+            block, state = encoder.encode(words)
+            if len(block) < len(text):
+                encoder.commit(state)
+                yield text, block
+                continue
+        yield text, text
+
+
+def main():
+    parser = argparse.ArgumentParser(description='Convert g-code to grbl binary blocks.')
+    parser.add_argument('gcode_file', type=argparse.FileType('r'), help='g-code filename to be converted')
+    parser.add_argument('-o', '--output', type=argparse.FileType('w'), default=sys.stdout, help='output file, default stdout')
+    parser.add_argument('-s', '--stats', action='store_true', default=False, help='print input and output sizes')
+    parser.add_argument('-c', '--check', action='store_true', default=False, help='verify the output by decoding it')
+    args = parser.parse_args()
+
+    decoder = Decoder()
+    size_in = size_out = lines = binary = 0
+
+    for text, out in convert(args.gcode_file):
+        args.output.write(out + '\n')
+        lines += 1
+        size_in += len(text) + 1
+        size_out += len(out) + 1
+        if out[0] == PREFIX:
+            binary += 1
+            if args.check and decoder.decode(out) != parse_words(text):
+                sys.exit('Check failed: %s -> %s' % (text, out))
+
+    if args.stats:
+        sys.stderr.write('%d lines, %d binary, %d -> %d bytes (%.2fx)\n' %
+                         (lines, binary, size_in, size_out, size_in / float(max(size_out, 1))))
+
+
+if __name__ == '__main__':
+    main()
@@ -0,0 +1,515 @@
+#!/usr/bin/env python3
+"""\
+
+Compute whole-program look-ahead exit speed hints for grbl
+
+Grbl's planner only sees the blocks in its buffer and has to plan a
+stop at the end of it, so short segments such as arcs and curves may
+run well below the programmed feed rate. This script runs the planner
+math of plan_buffer_line() over the whole program, from the end back,
+and adds the resulting exit speed of each motion line as an E word,
+e.g. G1X10Y20F500E480.5. Grbl, built with PLANNER_EXIT_SPEED_HINTS
+(disabled by default), reported as 'X' in the [OPT:] line of $I, then plans the last block
+in its buffer to exit at this speed instead of at a stop. The hint of
+an arc is for its end, grbl computes the hints of the arc segments.
+
+The hints depend on the machine settings, read from a file with the
+output of $$ (-s), and on the work offset (-w) since grbl plans the
+motions rounded to steps in machine coordinates. Hints are rounded
+down, a hint that turns out too high for the next block makes grbl
+replan its buffer.
+
+Lines that stop motion or that can not be evaluated here end a run of
+hinted blocks: the block before them exits at a stop as without a
+hint. These are lines with other words than motions, G17-G21,
+G90/G91, G93/G94, F and N, e.g. spindle and coolant changes, dwells,
+probing, offset changes, parameters and expressions. Lines within
+O-word subroutines and loops are left unchanged since they are
+replayed by grbl. Existing E words are removed. The output is
+filtered as grbl would see it, without spaces and comments, and may
+be converted to binary blocks by gcode2bin.py.
+
+The hinted program must keep grbl's buffer filled, e.g. streamed by
+stream.py or run from storage with $FR. If the stream stalls grbl
+still stops at the end of the buffer, but may not have the distance
+left to decelerate within its acceleration limits. The same applies to
+a feed hold near the end of the buffer.
+
+-p simulates grbl's planner with a buffer of the given number of
+blocks, reported by $I, and prints the estimated run time with and
+without hints. -c writes the per block feed profiles to a CSV file.
+
+Usage: lookahead.py [-s settings.txt] [-w x,y,z] [-o out.nc] [-p blocks] [-c profile.csv] in.nc
+
+---------------------
+The MIT License (MIT)
+
+Copyright (c) 2017 Terje Io
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+---------------------
+"""
+
+import argparse
+import math
+import re
+import sys
+
+AXES = 'XYZABC'
+MM_PER_INCH = 25.4
+MINIMUM_FEED_RATE = 1.0         # config.h
+MINIMUM_JUNCTION_SPEED = 0.0    # config.h
+N_ARC_CORRECTION = 12           # config.h
+ARC_ANGULAR_TRAVEL_EPSILON = 5E-7
+SOME_LARGE_VALUE = 1.0E+38      # nuts_bolts.h
+HINT_MARGIN = 0.99              # Hints are scaled down by this and rounded down to 0.1 units/min
+
+# Defaults as DEFAULTS_GENERIC, overridden by the settings file.
+SETTINGS = {11: 0.01, 12: 0.002}
+for axis in range(3):
+    SETTINGS.update({100 + axis: 250.0, 110 + axis: 500.0, 120 + axis: 10.0})
+
+WORD = re.compile(r'([A-Z])([-+]?(?:\d+\.?\d*|\.\d+))')
+OWORD = re.compile(r'O\d+(SUB|ENDSUB|WHILE|ENDWHILE|DO|REPEAT|ENDREPEAT)?')
+MODAL_G = {0, 1, 2, 3, 17, 18, 19, 20, 21, 90, 91, 93, 94}
+STOP_G = {4, 40, 49, 61, 80, 98, 99}     # Do not move, but end a run of blocks
+PLANES = {17: (0, 1, 2), 18: (2, 0, 1), 19: (1, 2, 0)}
+
+
+def filter_line(line):
+    """Removes spaces, control characters and comments and upcases, as grbl's protocol does."""
+    out = []
+    comment = False
+    for c in line:
+        if comment:
+            comment = c != ')'
+        elif c == '(':
+            comment = True
+        elif c == ';':
+            break
+        elif c > ' ':
+            out.append(c.upper())
+    return ''.join(out)
+
+
+def read_settings(file):
+    settings = dict(SETTINGS)
+    for line in file:
+        m = re.match(r'\$(\d+)=([-+]?[\d.]+)', line.strip())
+        if m:
+            settings[int(m.group(1))] = float(m.group(2))
+    return settings
+
+
+def lround(value):
+    """Rounds half away from zero, as lroundf()."""
+    return int(math.floor(value + 0.5)) if value >= 0.0 else -int(math.floor(-value + 0.5))
+
+
+def limit_value_by_axis_maximum(max_value, unit_vec):
+    limit = SOME_LARGE_VALUE
+    for idx, u in enumerate(unit_vec):
+        if u != 0.0:
+            limit = min(limit, abs(max_value[idx] / u))
+    return limit
+
+
+class Machine(object):
+    """Axis settings in grbl's internal units (steps/mm, mm/min, mm/min^2)."""
+
+    def __init__(self, settings):
+        self.n_axis = max(3, len([a for a in range(6) if 110 + a in settings]))
+        self.steps_per_mm = [settings.get(100 + a, 250.0) for a in range(self.n_axis)]
+        self.max_rate = [settings.get(110 + a, 500.0) for a in range(self.n_axis)]
+        self.acceleration = [settings.get(120 + a, 10.0) * 60.0 * 60.0 for a in range(self.n_axis)]
+        self.junction_deviation = settings[11]
+        self.arc_tolerance = settings[12]
+
+    def steps(self, position):
+        return [lround(p * spm) for p, spm in zip(position, self.steps_per_mm)]
+
+
+class Block(object):
+    """A planner block, computed as by plan_buffer_line() from the steps of the motion."""
+
+    def __init__(self, machine, steps, rapid, feed_rate, inverse_time, line):
+        delta = [s / spm for s, spm in zip(steps, machine.steps_per_mm)]
+        self.line = line
+        self.millimeters = math.sqrt(sum(d * d for d in delta))
+        self.unit_vec = [d / self.millimeters for d in delta]
+        self.acceleration = limit_value_by_axis_maximum(machine.acceleration, self.unit_vec)
+        self.rapid_rate = limit_value_by_axis_maximum(machine.max_rate, self.unit_vec)
+        if rapid:
+            self.nominal_speed = self.rapid_rate
+        else:
+            rate = feed_rate * self.millimeters if inverse_time else feed_rate
+            self.nominal_speed = max(min(rate, self.rapid_rate), MINIMUM_FEED_RATE)
+        self.max_entry_speed_sqr = 0.0
+        self.exit_speed_sqr = 0.0   # Whole program plan
+        self.hint_sqr = 0.0         # Exit speed hint as used by grbl
+        self.arc = None             # Segment hint parameters and remaining segments for arc segments
+
+    def junction(self, machine, prev):
+        """Sets the max entry speed from the previous block, left at 0 if starting from rest."""
+        if prev is None:
+            return
+        cos_theta = -sum(p * u for p, u in zip(prev.unit_vec, self.unit_vec))
+        if cos_theta > 0.999999:
+            junction_sqr = MINIMUM_JUNCTION_SPEED * MINIMUM_JUNCTION_SPEED
+        elif cos_theta < -0.999999:
+            junction_sqr = SOME_LARGE_VALUE
+        else:
+            junction_vec = [u - p for p, u in zip(prev.unit_vec, self.unit_vec)]
+            magnitude = math.sqrt(sum(j * j for j in junction_vec))
+            junction_acceleration = limit_value_by_axis_maximum(machine.acceleration, [j / magnitude for j in junction_vec])
+            sin_theta_d2 = math.sqrt(0.5 * (1.0 - cos_theta))
+            junction_sqr = max(MINIMUM_JUNCTION_SPEED * MINIMUM_JUNCTION_SPEED,
+                               (junction_acceleration * machine.junction_deviation * sin_theta_d2) / (1.0 - sin_theta_d2))
+        self.max_entry_speed_sqr = min(junction_sqr, min(prev.nominal_speed, self.nominal_speed) ** 2)
+
+
+def arc_points(machine, position, target, offset, radius, plane, clockwise):
+    """Returns the end points of the segments of an arc as generated by mc_arc(), and the junction
+       speed and the speed gain per segment used by mc_arc() for the hints of the segments."""
+    axis_0, axis_1, axis_linear = plane
+    center_0 = position[axis_0] + offset[0]
+    center_1 = position[axis_1] + offset[1]
+    r_0, r_1 = -offset[0], -offset[1]
+    rt_0, rt_1 = target[axis_0] - center_0, target[axis_1] - center_1
+    angular_travel = math.atan2(r_0 * rt_1 - r_1 * rt_0, r_0 * rt_0 + r_1 * rt_1)
+    if clockwise:
+        if angular_travel >= -ARC_ANGULAR_TRAVEL_EPSILON:
+            angular_travel -= 2.0 * math.pi
+    elif angular_travel <= ARC_ANGULAR_TRAVEL_EPSILON:
+        angular_travel += 2.0 * math.pi
+    tolerance = machine.arc_tolerance
+    segments = int(math.floor(abs(0.5 * angular_travel * radius) / math.sqrt(tolerance * (2.0 * radius - tolerance))))
+    points = []
+    hint = (0.0, 0.0)
+
+    if segments:
+        theta_per_segment = angular_travel / segments
+        linear_per_segment = (target[axis_linear] - position[axis_linear]) / segments
+        cos_t = 2.0 - theta_per_segment * theta_per_segment
+        sin_t = theta_per_segment * 0.16666667 * (cos_t + 4.0)
+        cos_t *= 0.5
+        point = list(position)
+        count = 0
+        for i in range(1, segments):
+            if count < N_ARC_CORRECTION:
+                r_i = r_0 * sin_t + r_1 * cos_t
+                r_0 = r_0 * cos_t - r_1 * sin_t
+                r_1 = r_i
+                count += 1
+            else:
+                cos_ti = math.cos(i * theta_per_segment)
+                sin_ti = math.sin(i * theta_per_segment)
+                r_0 = -offset[0] * cos_ti + offset[1] * sin_ti
+                r_1 = -offset[0] * sin_ti - offset[1] * cos_ti
+                count = 0
+            point[axis_0] = center_0 + r_0
+            point[axis_1] = center_1 + r_1
+            point[axis_linear] += linear_per_segment
+            points.append(list(point))
+
+        # Lower bounds of the segment junction speed and the speed gained over a segment, the segment
+        # end points are rounded to steps by the planner.
+        acceleration = min(machine.acceleration[axis_0], machine.acceleration[axis_1])
+        step_mm = max(1.0 / machine.steps_per_mm[axis_0], 1.0 / machine.steps_per_mm[axis_1])
+        if linear_per_segment != 0.0:
+            acceleration = min(acceleration, machine.acceleration[axis_linear])
+            step_mm = max(step_mm, 1.0 / machine.steps_per_mm[axis_linear])
+        segment_mm = math.hypot(2.0 * radius * math.sin(0.5 * abs(theta_per_segment)), linear_per_segment)
+        rounding_mm = 2.0 * step_mm
+        if segment_mm > rounding_mm:
+            theta = abs(theta_per_segment) + 2.0 * math.asin(rounding_mm / segment_mm)
+            if theta < math.pi:
+                cos_theta_d2 = math.cos(0.5 * theta)
+                hint = (acceleration * machine.junction_deviation * cos_theta_d2 / (1.0 - cos_theta_d2),
+                        2.0 * acceleration * (segment_mm - rounding_mm))
+
+    points.append(list(target))
+    return points, hint
+
+
+class Program(object):
+    """Parses a program to planner blocks, None at lines that stop motion. Positions are in
+       machine coordinates, None if not known."""
+
+    def __init__(self, machine, offset):
+        self.machine = machine
+        self.offset = offset
+        self.position = list(offset)
+        self.steps = machine.steps(self.position)
+        self.motion = 0
+        self.plane = PLANES[17]
+        self.inches = False
+        self.incremental = False
+        self.inverse_time = False
+        self.feed_rate = 0.0
+        self.lines = []     # (text, blocks of the line or None if a stop, inches)
+        self.blocks = []
+
+    def stop(self, text, position=None):
+        """Adds a line that stops motion, the position is lost unless given."""
+        self.position = position or [None] * self.machine.n_axis
+        if None not in self.position:
+            self.steps = self.machine.steps(self.position)
+        self.lines.append((text, None, self.inches))
+        self.blocks.append(None)
+
+    def add(self, text):
+        words = WORD.findall(text)
+        if ''.join(l + v for l, v in words) != text:
+            return self.stop(text)  # Parameters, expressions or other syntax not handled here.
+
+        values = {}
+        motion = self.motion
+        stop = False
+        for letter, value in words:
+            value = float(value)
+            if letter == 'G':
+                g = int(value) if value == int(value) else None
+                if g not in MODAL_G:
+                    if g not in STOP_G:
+                        return self.stop(text)  # May move or change offsets.
+                    stop = True
+                elif g <= 3:
+                    motion = g
+                elif g in PLANES:
+                    self.plane = PLANES[g]
+                elif g in (20, 21):
+                    self.inches = g == 20
+                elif g in (90, 91):
+                    self.incremental = g == 91
+                else:
+                    self.inverse_time = g == 93
+            elif letter in 'FNIJKRE' or letter in AXES[:self.machine.n_axis]:
+                values[letter] = value
+            else:
+                stop = True  # M, S, T, P and other words may stop motion.
+
+        # Existing E words are removed, a new one is added to motion lines.
+        text = ''.join(l + v for l, v in words if l != 'E')
+        scale = MM_PER_INCH if self.inches else 1.0
+        self.motion = motion
+        if 'F' in values:
+            self.feed_rate = values['F'] if self.inverse_time else values['F'] * scale
+
+        target = list(self.position)
+        axis_words = False
+        for idx, letter in enumerate(AXES[:self.machine.n_axis]):
+            if letter in values:
+                axis_words = True
+                if not self.incremental:
+                    target[idx] = values[letter] * scale + self.offset[idx]
+                elif target[idx] is not None:
+                    target[idx] += values[letter] * scale
+
+        if stop:
+            return self.stop(text, target)
+
+        if not axis_words:
+            if set(values) - set('FNE'):
+                return self.stop(text, target)
+            self.lines.append((text, [], self.inches))
+            return
+
+        if None in self.position or None in target:
+            return self.stop(text, target)
+
+        arc = None
+        if motion <= 1:
+            points = [target]
+        else:
+            axis_0, axis_1 = self.plane[0], self.plane[1]
+            if 'R' in values:
+                x = target[axis_0] - self.position[axis_0]
+                y = target[axis_1] - self.position[axis_1]
+                r = values['R'] * scale
+                h_x2_div_d = 4.0 * r * r - x * x - y * y
+                if h_x2_div_d < 0.0 or (x == 0.0 and y == 0.0):
+                    return self.stop(text)
+                h_x2_div_d = -math.sqrt(h_x2_div_d) / math.hypot(x, y)
+                if motion == 3:
+                    h_x2_div_d = -h_x2_div_d
+                if r < 0.0:
+                    h_x2_div_d = -h_x2_div_d
+                    r = -r
+                offset = [0.5 * (x - y * h_x2_div_d), 0.5 * (y + x * h_x2_div_d)]
+                radius = r
+            else:
+                ijk = [values.get(l, 0.0) * scale for l in 'IJK']
+                offset = [ijk[axis_0], ijk[axis_1]]
+                radius = math.hypot(offset[0], offset[1])
+            points, arc = arc_points(self.machine, self.position, target, offset, radius, self.plane, motion == 2)
+
+        # As mc_arc(), inverse time arcs with segments are planned with F * segments as feed rate.
+        inverse_time = self.inverse_time and motion != 0
+        feed_rate = self.feed_rate
+        if inverse_time and len(points) > 1:
+            feed_rate *= len(points)
+            inverse_time = False
+
+        blocks = []
+        for idx, point in enumerate(points):
+            target_steps = self.machine.steps(point)
+            steps = [t - p for t, p in zip(target_steps, self.steps)]
+            if any(steps):  # Motions shorter than a step are dropped by the planner.
+                block = Block(self.machine, steps, motion == 0, feed_rate, inverse_time, len(self.lines))
+                block.junction(self.machine, self.blocks[-1] if self.blocks else None)
+                if arc and idx < len(points) - 1:
+                    block.arc = arc + (len(points) - 1 - idx,)
+                self.blocks.append(block)
+                blocks.append(block)
+                self.steps = target_steps
+        self.position = target
+        self.lines.append((text, blocks, self.inches))
+
+    @staticmethod
+    def round_hint(speed_sqr, scale):
+        """Returns the hint for the exit speed in units/min, rounded down."""
+        return math.floor(HINT_MARGIN * math.sqrt(speed_sqr) / scale * 10.0) / 10.0
+
+    def plan(self):
+        """Reverse pass over the whole program, a stop ends each run of blocks. The entry speed of a
+           block is planned from its hint as used by grbl, so grbl never has to replan a full buffer."""
+        exit_speed_sqr = 0.0
+        line_exit_sqr = 0.0
+        for block in reversed(self.blocks):
+            if block is None:
+                exit_speed_sqr = 0.0
+                continue
+            block.exit_speed_sqr = exit_speed_sqr
+            if block.arc is None:
+                # Last block of a line, hinted by its E word.
+                scale = MM_PER_INCH if self.lines[block.line][2] else 1.0
+                block.hint_sqr = (self.round_hint(exit_speed_sqr, scale) * scale) ** 2
+                line_exit_sqr = block.hint_sqr
+            else:
+                junction_speed_sqr, segment_speed_sqr, remaining = block.arc
+                block.hint_sqr = min(junction_speed_sqr, line_exit_sqr + segment_speed_sqr * remaining)
+            hint_sqr = min(block.hint_sqr, block.nominal_speed ** 2)
+            exit_speed_sqr = min(block.max_entry_speed_sqr, hint_sqr + 2.0 * block.acceleration * block.millimeters)
+
+    def output(self):
+        """Yields the lines with exit speed hints added."""
+        for text, blocks, inches in self.lines:
+            if blocks:
+                hint = self.round_hint(blocks[-1].exit_speed_sqr, MM_PER_INCH if inches else 1.0)
+                if hint > 0.0:
+                    text += 'E%g' % hint
+            yield text
+
+
+def block_time(entry_sqr, exit_sqr, block):
+    """Returns the time in minutes to execute a block with a trapezoidal profile."""
+    a, d = block.acceleration, block.millimeters
+    peak_sqr = min(block.nominal_speed ** 2, 0.5 * (entry_sqr + exit_sqr) + a * d)
+    peak = math.sqrt(peak_sqr)
+    accel_d = (peak_sqr - entry_sqr) / (2.0 * a)
+    decel_d = (peak_sqr - exit_sqr) / (2.0 * a)
+    cruise = max(0.0, d - accel_d - decel_d)
+    return (peak - math.sqrt(entry_sqr)) / a + (peak - math.sqrt(exit_sqr)) / a + cruise / peak
+
+
+def simulate(blocks, buffer_size, hints):
+    """Simulates grbl's planner with a full buffer of buffer_size blocks. Returns the exit speed
+       of each block and the total time."""
+    exits = []
+    total = 0.0
+    entry_sqr = 0.0
+    n = len(blocks)
+    for k, block in enumerate(blocks):
+        if block is None:
+            exits.append(None)
+            entry_sqr = 0.0
+            continue
+        # Reverse pass over the blocks in the buffer while block k is executed.
+        end = k
+        while end + 1 < n and end + 1 < k + buffer_size and blocks[end + 1] is not None:
+            end += 1
+        if end + 1 < n and blocks[end + 1] is not None:
+            exit_speed_sqr = min(blocks[end].hint_sqr, blocks[end].nominal_speed ** 2) if hints else 0.0
+        else:
+            exit_speed_sqr = 0.0 # Program end or stop.
+        for i in range(end, k, -1):
+            b = blocks[i]
+            exit_speed_sqr = min(b.max_entry_speed_sqr, exit_speed_sqr + 2.0 * b.acceleration * b.millimeters)
+        # Forward: the exit is limited by what can be reached from the actual entry.
+        exit_speed_sqr = min(exit_speed_sqr, entry_sqr + 2.0 * block.acceleration * block.millimeters)
+        total += block_time(entry_sqr, exit_speed_sqr, block)
+        exits.append(exit_speed_sqr)
+        entry_sqr = exit_speed_sqr
+    return exits, total
+
+
+def main():
+    parser = argparse.ArgumentParser(description='Add whole-program look-ahead exit speed hints to g-code.')
+    parser.add_argument('gcode_file', type=argparse.FileType('r'), help='g-code filename')
+    parser.add_argument('-s', '--settings', type=argparse.FileType('r'), help='file with the output of $$')
+    parser.add_argument('-w', '--offset', default='', help='work offset in mm as x,y,z..., default 0')
+    parser.add_argument('-o', '--output', type=argparse.FileType('w'), default=sys.stdout, help='output file, default stdout')
+    parser.add_argument('-p', '--profile', type=int, metavar='BLOCKS', help='simulate a planner buffer of BLOCKS blocks')
+    parser.add_argument('-c', '--csv', type=argparse.FileType('w'), help='write the simulated feed profiles to a CSV file')
+    args = parser.parse_args()
+
+    machine = Machine(read_settings(args.settings) if args.settings else SETTINGS)
+    offset = [float(v) for v in args.offset.split(',') if v]
+    program = Program(machine, (offset + [0.0] * machine.n_axis)[:machine.n_axis])
+
+    stack = []  # Open O-word subroutines and loops
+    for raw in args.gcode_file:
+        text = filter_line(raw)
+        if not text:
+            continue
+        oword = OWORD.match(text)
+        if oword:
+            keyword = oword.group(1)
+            if keyword in ('SUB', 'DO', 'REPEAT') or keyword == 'WHILE' and (not stack or stack[-1] != 'DO'):
+                stack.append(keyword)
+            elif keyword in ('ENDSUB', 'ENDWHILE', 'ENDREPEAT', 'WHILE') and stack:
+                stack.pop()
+        if oword or stack or text[0] in '$/%&':
+            program.stop(text, list(program.position) if text == '%' else None)
+        else:
+            program.add(text)
+
+    program.plan()
+
+    for text in program.output():
+        args.output.write(text + '\n')
+
+    if args.profile or args.csv:
+        buffer_size = args.profile or 16
+        stops, time_stops = simulate(program.blocks, buffer_size, False)
+        hinted, time_hinted = simulate(program.blocks, buffer_size, True)
+        if args.csv:
+            args.csv.write('line,mm,nominal,exit_without_hints,exit_with_hints,exit_whole_program\n')
+            for block, s, h in zip(program.blocks, stops, hinted):
+                if block is not None:
+                    args.csv.write('%d,%.4f,%.1f,%.1f,%.1f,%.1f\n' % (block.line + 1, block.millimeters, block.nominal_speed,
+                                   math.sqrt(s), math.sqrt(h), math.sqrt(block.exit_speed_sqr)))
+        sys.stderr.write('%d blocks, buffer %d: %.2f s without hints, %.2f s with hints (%.1f%% faster)\n' %
+                         (len([b for b in program.blocks if b is not None]), buffer_size, time_stops * 60.0, time_hinted * 60.0,
+                          100.0 * (time_stops - time_hinted) / max(time_hinted, 1E-9)))
+
+
+if __name__ == '__main__':
+    main()
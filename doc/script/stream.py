@@ -1,23 +1,42 @@
-#!/usr/bin/env python
+#!/usr/bin/env python3
 """\
 
 Stream g-code to grbl controller
 
-This script differs from the simple_stream.py script by 
+This script differs from the simple_stream.py script by
 tracking the number of characters in grbl's serial read
 buffer. This allows grbl to fetch the next line directly
-from the serial buffer and does not have to wait for a 
+from the serial buffer and does not have to wait for a
 response from the computer. This effectively adds another
 buffer layer to prevent buffer starvation.
 
+Responses are read by a separate thread, so the streamer
+sends the next line as soon as the acknowledgement arrives
+and never blocks on its own output. Realtime commands are
+injected out of band, either periodically (status reports)
+or typed on the console while streaming:
+
+  ?  status report       !  feed hold          ~  cycle start
+  f+ f- F+ F- f0         feed override +10/-10/+1/-1/100%
+  r0 r1 r2               rapid override 100/50/25%
+  s+ s- S+ S- s0 ss      spindle override +10/-10/+1/-1/100%/stop
+  x  soft-reset (ctrl-x)
+
+The serial RX buffer size is read from the $I build info,
+and per-line latency (sent to acknowledged) and throughput
+are reported when done. A device path or a pty may be used,
+pySerial is used if installed, else the port is opened as a
+POSIX terminal.
+
 CHANGELOG:
+- 20171020: Rewritten for Python 3. Threaded response reader,
+  RX buffer size from build info, realtime commands, line
+  latency statistics and sequenced streaming protocol.
+  Coalesced acknowledgements, ok:<lines> and ok:<seq>,<rx>.
 - 20161212: Added push message feedback for simple streaming
 - 20140714: Updated baud rate to 115200. Added a settings
   write mode via simple streaming method. MIT-licensed.
 
-TODO: 
-- Add runtime command capabilities
-
 ---------------------
 The MIT License (MIT)
 
@@ -43,102 +62,307 @@ THE SOFTWARE.
 ---------------------
 """
 
-import serial
+import argparse
+import collections
+import os
 import re
-import time
+import select
 import sys
-import argparse
-# import threading
-
-RX_BUFFER_SIZE = 128
-
-# Define command line argument interface
-parser = argparse.ArgumentParser(description='Stream g-code file to grbl. (pySerial and argparse libraries required)')
-parser.add_argument('gcode_file', type=argparse.FileType('r'),
-        help='g-code filename to be streamed')
-parser.add_argument('device_file',
-        help='serial device path')
-parser.add_argument('-q','--quiet',action='store_true', default=False, 
-        help='suppress output text')
-parser.add_argument('-s','--settings',action='store_true', default=False, 
-        help='settings write mode')        
-args = parser.parse_args()
-
-# Periodic timer to query for status reports
-# TODO: Need to track down why this doesn't restart consistently before a release.
-# def periodic():
-#     s.write('?')
-#     t = threading.Timer(0.1, periodic) # In seconds
-#     t.start()
-
-# Initialize
-s = serial.Serial(args.device_file,115200)
-f = args.gcode_file
-verbose = True
-if args.quiet : verbose = False
-settings_mode = False
-if args.settings : settings_mode = True
-
-# Wake up grbl
-print "Initializing grbl..."
-s.write("\r\n\r\n")
-
-# Wait for grbl to initialize and flush startup text in serial input
-time.sleep(2)
-s.flushInput()
-
-# Stream g-code to grbl
-l_count = 0
-if settings_mode:
-    # Send settings file via simple call-response streaming method. Settings must be streamed
-    # in this manner since the EEPROM accessing cycles shut-off the serial interrupt.
-    print "SETTINGS MODE: Streaming", args.gcode_file.name, " to ", args.device_file
-    for line in f:
-        l_count += 1 # Iterate line counter    
-        # l_block = re.sub('\s|\(.*?\)','',line).upper() # Strip comments/spaces/new line and capitalize
-        l_block = line.strip() # Strip all EOL characters for consistency
-        if verbose: print 'SND: ' + str(l_count) + ':' + l_block,
-        s.write(l_block + '\n') # Send g-code block to grbl
-        while 1:
-            grbl_out = s.readline().strip() # Wait for grbl response with carriage return
-            if grbl_out.find('ok') < 0 and grbl_out.find('error') < 0 :
-                print "\n  Debug: ",grbl_out,
-            else : 
-                if verbose: print 'REC:',grbl_out
-                break
-else:    
-    # Send g-code program via a more agressive streaming protocol that forces characters into
-    # Grbl's serial read buffer to ensure Grbl has immediate access to the next g-code command
-    # rather than wait for the call-response serial protocol to finish. This is done by careful
-    # counting of the number of characters sent by the streamer to Grbl and tracking Grbl's 
-    # responses, such that we never overflow Grbl's serial read buffer. 
-    g_count = 0
-    c_line = []
-    # periodic() # Start status report periodic timer
-    for line in f:
-        l_count += 1 # Iterate line counter
-        # l_block = re.sub('\s|\(.*?\)','',line).upper() # Strip comments/spaces/new line and capitalize
-        l_block = line.strip()
-        c_line.append(len(l_block)+1) # Track number of characters in grbl serial read buffer
-        grbl_out = '' 
-        while sum(c_line) >= RX_BUFFER_SIZE-1 | s.inWaiting() :
-            out_temp = s.readline().strip() # Wait for grbl response
-            if out_temp.find('ok') < 0 and out_temp.find('error') < 0 :
-                print "  Debug: ",out_temp # Debug response
-            else :
-                grbl_out += out_temp;
-                g_count += 1 # Iterate g-code counter
-                grbl_out += str(g_count); # Add line finished indicator
-                del c_line[0] # Delete the block character count corresponding to the last 'ok'
-        if verbose: print "SND: " + str(l_count) + " : " + l_block,
-        s.write(l_block + '\n') # Send g-code block to grbl
-        if verbose : print "BUF:",str(sum(c_line)),"REC:",grbl_out
-
-# Wait for user input after streaming is completed
-print "G-code streaming finished!\n"
-print "WARNING: Wait until grbl completes buffered g-code blocks before exiting."
-raw_input("  Press <Enter> to exit and disable grbl.") 
-
-# Close file and serial port
-f.close()
-s.close()
+import threading
+import time
+
+try:
+    import serial
+except ImportError:
+    serial = None
+
+RX_BUFFER_SIZE = 128  # Used if the size can not be read from the build info
+
+# ok, ok:<lines>, ok:<seq>,<rx>, error:<code> and error:<code>,<seq>,<rx>
+ACK_RESPONSE = re.compile(r'^(ok|error)(?::(.*))?$')
+
+REALTIME_COMMANDS = {
+    '?': b'?', '!': b'!', '~': b'~', 'x': b'\x18',
+    'f0': b'\x90', 'f+': b'\x91', 'f-': b'\x92', 'F+': b'\x93', 'F-': b'\x94',
+    'r0': b'\x95', 'r1': b'\x96', 'r2': b'\x97',
+    's0': b'\x99', 's+': b'\x9A', 's-': b'\x9B', 'S+': b'\x9C', 'S-': b'\x9D', 'ss': b'\x9E',
+}
+
+
+class Port(object):
+    """Serial port, pySerial if available else a raw POSIX terminal (works with ptys)."""
+
+    def __init__(self, path, baud):
+        self.ser = None
+        if serial is not None:
+            self.ser = serial.Serial(path, baud, timeout=0.1)
+        else:
+            import termios
+            import tty
+            self.fd = os.open(path, os.O_RDWR | os.O_NOCTTY)
+            tty.setraw(self.fd)
+            attr = termios.tcgetattr(self.fd)
+            speed = getattr(termios, 'B%d' % baud, None)
+            if speed is not None:
+                attr[4] = attr[5] = speed
+                termios.tcsetattr(self.fd, termios.TCSANOW, attr)
+
+    def write(self, data):
+        if self.ser is not None:
+            self.ser.write(data)
+        else:
+            while data:
+                data = data[os.write(self.fd, data):]
+
+    def read(self):
+        """Returns available bytes, waits up to 0.1s for data."""
+        if self.ser is not None:
+            return self.ser.read(max(1, self.ser.in_waiting))
+        if select.select([self.fd], [], [], 0.1)[0]:
+            return os.read(self.fd, 4096)
+        return b''
+
+    def flush_input(self):
+        if self.ser is not None:
+            self.ser.reset_input_buffer()
+        else:
+            while self.read():
+                pass
+
+    def close(self):
+        if self.ser is not None:
+            self.ser.close()
+        else:
+            os.close(self.fd)
+
+
+class Streamer(object):
+
+    def __init__(self, port, verbose, log):
+        self.port = port
+        self.verbose = verbose
+        self.log = log
+        self.write_lock = threading.Lock()
+        self.cond = threading.Condition()
+        self.pending = collections.deque()  # (line number, characters, time sent, block, sequence number)
+        self.buffered = 0
+        self.responses = []  # Responses not matched to a sent line, used by query()
+        self.latencies = []
+        self.errors = 0
+        self.running = True
+        self.reader = threading.Thread(target=self.read_loop)
+        self.reader.daemon = True
+        self.reader.start()
+
+    def write(self, data):
+        with self.write_lock:
+            self.port.write(data)
+
+    def realtime(self, cmd):
+        self.write(cmd)
+
+    def read_loop(self):
+        data = b''
+        while self.running:
+            data += self.port.read()
+            while b'\n' in data:
+                line, data = data.split(b'\n', 1)
+                self.handle(line.strip().decode('ascii', 'replace'))
+
+    def acknowledge(self, response, now, error):
+        """Pops the oldest pending line, called with self.cond held."""
+        l_count, chars, sent, block, seq = self.pending.popleft()
+        self.buffered -= chars
+        latency = now - sent
+        self.latencies.append(latency)
+        if error:
+            self.errors += 1
+            print('ERROR: line %d: %s -> %s' % (l_count, block, response))
+        elif self.verbose:
+            print('REC: %d %s (%.1f ms)' % (l_count, response, latency * 1000.0))
+        if self.log:
+            self.log.write('%d,%.6f,%.6f,%s\n' % (l_count, sent, latency, response))
+
+    def handle(self, response):
+        if not response:
+            return
+        m = ACK_RESPONSE.match(response)
+        if m:
+            now = time.time()
+            error = m.group(1) == 'error'
+            fields = m.group(2).split(',') if m.group(2) else []
+            with self.cond:
+                if not self.pending:
+                    self.responses.append(response)
+                elif len(fields) >= 2 and fields[-2].isdigit():
+                    # Sequenced: ok:<seq>,<rx> or error:<code>,<seq>,<rx> acknowledges all lines up to <seq>.
+                    seq = int(fields[-2])
+                    while self.pending and self.pending[0][4] is not None and self.pending[0][4] != seq:
+                        self.acknowledge(response, now, False)
+                    if self.pending:
+                        self.acknowledge(response, now, error)
+                else:
+                    # ok:<lines> from acknowledgement coalescing ($61), else a single line.
+                    lines = int(fields[0]) if not error and fields and fields[0].isdigit() else 1
+                    for _ in range(min(lines, len(self.pending))):
+                        self.acknowledge(response, now, error)
+                self.cond.notify_all()
+        elif response.startswith('<'):
+            print('STATUS: ' + response)
+        else:
+            with self.cond:
+                self.responses.append(response)
+                self.cond.notify_all()
+            if self.verbose or response.startswith('ALARM'):
+                print('MSG: ' + response)
+
+    def query(self, cmd, timeout=2.0):
+        """Sends an unstreamed command and returns its response lines, up to and including ok/error."""
+        with self.cond:
+            self.responses = []
+        self.write(cmd.encode('ascii') + b'\n')
+        deadline = time.time() + timeout
+        with self.cond:
+            while not any(r.startswith('ok') or r.startswith('error') for r in self.responses):
+                if not self.cond.wait(max(0.0, deadline - time.time())):
+                    break
+            return list(self.responses)
+
+    def send(self, l_count, block, limit, seq=None):
+        """Sends a line when it fits in the RX buffer, limit = 1 for send-response streaming."""
+        data = (block + '\n').encode('ascii')
+        with self.cond:
+            while self.pending and (len(self.pending) >= limit or self.buffered + len(data) > self.rx_size):
+                self.cond.wait()
+            self.pending.append((l_count, len(data), time.time(), block, seq))
+            self.buffered += len(data)
+        self.write(data)
+        if self.verbose:
+            print('SND: %d : %s BUF: %d' % (l_count, block, self.buffered))
+
+    def wait_done(self):
+        with self.cond:
+            while self.pending:
+                self.cond.wait()
+
+    def stop(self):
+        self.running = False
+        self.reader.join()
+
+
+def periodic_status(streamer, interval, done):
+    while not done.wait(interval):
+        streamer.realtime(b'?')
+
+
+def console_commands(streamer, done):
+    while not done.is_set():
+        if not select.select([sys.stdin], [], [], 0.2)[0]:
+            continue
+        cmd = sys.stdin.readline()
+        if not cmd:  # End of input, not interactive
+            return
+        cmd = cmd.strip()
+        if cmd in REALTIME_COMMANDS:
+            streamer.realtime(REALTIME_COMMANDS[cmd])
+        elif cmd:
+            print('Unknown realtime command: ' + cmd)
+
+
+def main():
+    # Define command line argument interface
+    parser = argparse.ArgumentParser(description='Stream g-code file to grbl. (pySerial optional, used if installed)')
+    parser.add_argument('gcode_file', type=argparse.FileType('r'),
+            help='g-code filename to be streamed')
+    parser.add_argument('device_file',
+            help='serial device or pty path')
+    parser.add_argument('-q', '--quiet', action='store_true', default=False,
+            help='suppress output text')
+    parser.add_argument('-s', '--settings', action='store_true', default=False,
+            help='settings write mode, send-response streaming')
+    parser.add_argument('-b', '--baud', type=int, default=115200,
+            help='baud rate, default 115200')
+    parser.add_argument('-r', '--rx-buffer', type=int, default=0,
+            help='serial RX buffer size, default is read from $I build info')
+    parser.add_argument('-i', '--status-interval', type=float, default=0.0,
+            help='seconds between status report requests, 0 disables')
+    parser.add_argument('-n', '--sequenced', action='store_true', default=False,
+            help='use the sequenced line protocol, @<seq> line prefix')
+    parser.add_argument('-l', '--log', type=argparse.FileType('w'),
+            help='write per line latency CSV to file')
+    parser.add_argument('--no-reset', action='store_true', default=False,
+            help='do not wake up grbl and wait for the startup message')
+    args = parser.parse_args()
+
+    port = Port(args.device_file, args.baud)
+
+    if not args.no_reset:
+        # Wake up grbl, wait for it to initialize and flush startup text in serial input
+        print('Initializing grbl...')
+        port.write(b'\r\n\r\n')
+        time.sleep(2)
+        port.flush_input()
+
+    streamer = Streamer(port, not args.quiet, args.log)
+    if args.log:
+        args.log.write('line,sent,latency,response\n')
+
+    streamer.rx_size = (args.rx_buffer or RX_BUFFER_SIZE) - 1
+    if not args.rx_buffer:
+        for response in streamer.query('$I'):
+            m = re.match(r'\[OPT:[^,]*,(\d+),(\d+)', response)
+            if m:
+                streamer.rx_size = int(m.group(2)) - 1
+    print('RX buffer: %d characters' % (streamer.rx_size + 1))
+
+    done = threading.Event()
+    helpers = [threading.Thread(target=console_commands, args=(streamer, done))]
+    if args.status_interval > 0.0:
+        helpers.append(threading.Thread(target=periodic_status, args=(streamer, args.status_interval, done)))
+    for helper in helpers:
+        helper.daemon = True
+        helper.start()
+
+    # Stream g-code to grbl
+    # NOTE: Settings must be streamed via send-response since EEPROM writes may stall serial reception.
+    limit = 1 if args.settings else sys.maxsize
+    if args.settings:
+        print('SETTINGS MODE: Streaming', args.gcode_file.name, 'to', args.device_file)
+
+    l_count = 0
+    start = time.time()
+    for line in args.gcode_file:
+        block = line.strip()  # Strip all EOL characters for consistency
+        l_count += 1  # Iterate line counter
+        seq = None
+        if args.sequenced:
+            seq = (l_count - 1) & 0xFFFF
+            block = '@%d%s' % (seq, block)
+        streamer.send(l_count, block, limit, seq)
+    streamer.wait_done()
+    elapsed = time.time() - start
+
+    done.set()
+    streamer.stop()
+
+    latencies = sorted(streamer.latencies)
+    print('G-code streaming finished!')
+    print('Lines: %d, errors: %d, time: %.3f s, rate: %.1f lines/s' %
+          (l_count, streamer.errors, elapsed, l_count / elapsed if elapsed > 0.0 else 0.0))
+    if latencies:
+        print('Latency ms: min %.2f, mean %.2f, p50 %.2f, p99 %.2f, max %.2f' % (
+              latencies[0] * 1000.0, sum(latencies) / len(latencies) * 1000.0,
+              latencies[len(latencies) // 2] * 1000.0,
+              latencies[min(len(latencies) - 1, int(len(latencies) * 0.99))] * 1000.0,
+              latencies[-1] * 1000.0))
+    print('WARNING: Wait until grbl completes buffered g-code blocks before disconnecting.')
+
+    # Close file and serial port
+    args.gcode_file.close()
+    if args.log:
+        args.log.close()
+    port.close()
+
+
+if __name__ == '__main__':
+    main()
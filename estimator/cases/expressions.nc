@@ -0,0 +1,14 @@
+(Expressions, the division operator and the two argument ATAN.)
+(The expected trace is in expressions.trace, see gcode_test.sh.)
+G21 G90
+G0 X[10/2] (X5)
+#1=[100/4]
+G0 X#1 (X25)
+G0 X[7/0] (error:45, division by zero)
+G0 X[ATAN[1]/[1]] (X45)
+G0 Y[ATAN[1]/[-1]] (Y135)
+G0 X[2*3/4] Y[-9/2] (X1.5 Y-4.5)
+#<half>=[#1/2]
+G0 X[#<half>/[1+4]] (X2.5)
+G0 X[ATAN[1]] (error, ATAN requires [y]/[x])
+/G0 X99 (block delete is off, X99)
@@ -0,0 +1,1087 @@
+/*
+  estimator.c - offline job run time estimator
+  Part of Grbl
+
+  Copyright (c) 2017 Terje Io
+
+  Grbl is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  Grbl is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with Grbl.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+/*
+  A host driver that runs a g-code program through the unmodified Grbl core, the parser, motion control,
+  the planner, segment prep and the stepper interrupt handler, with a simulated step timer. The program
+  is executed at CPU speed and the run time is the sum of the step timer periods set by segment prep,
+  so junction deviation cornering, acceleration limits, arc segmentation and step rounding are those of
+  the controller.
+
+  Build on the host from the repository root, with the same config.h as the controller:
+
+    gcc -O2 -std=gnu11 -funsigned-char -pthread -DCORE_INSTANCE_PER_THREAD -Igrbl -Wl,--wrap=plan_buffer_line -o build/estimator estimator/estimator.c grbl/[a-z]*.c -lm
+
+  Usage: estimator [-s settings.txt] [-l lines.csv] [-j jobs] [-o results.csv] [-d storage] program.nc|directory...
+
+    -s  file with the output of $$ and $#, the machine settings and work offsets. Defaults from
+        defaults.h and zero offsets if not given.
+    -l  write the run time and distance of each line to a CSV file, for a single program only.
+    -j  number of programs to run concurrently, defaults to the number of CPU cores.
+    -o  write the results of each program to a CSV file.
+    -d  directory providing the job storage (hal.file), so that programs may upload, list, run, resume
+        and delete stored jobs with the $F commands. File names are upcased by the core.
+
+  Directories are expanded to the g-code files (.nc, .ngc, .gcode, .gc, .tap and .cnc) they contain.
+
+  The report has the predicted run time, the time spent in dwells, the time lost to acceleration, that
+  is the run time minus the time to execute every motion at its programmed (or max axis) rate, and a
+  histogram of the achieved versus programmed feed rate by distance and time. Errors and alarms are
+  reported with their file and line numbers. Motion targets are checked against the soft limits of
+  the max travel settings, $130 - $132, and the bounding box of the targets in machine coordinates is
+  reported. When more than one program is given a line per program is printed.
+
+  Each program is run by a controller instance of its own, the core state is thread-local, see
+  CORE_INSTANCE_PER_THREAD in config.h. Programs are handed out one at a time to a pool of worker
+  threads, so that a worker finishing early picks up the next program.
+
+  NOTE: The program is assumed streamed faster than executed, the planner buffer is kept full. Program
+  pauses (M0) resume immediately, homing and probing are not supported since there are no switches.
+  Hard and soft limits and homing are disabled and the program starts at machine zero, soft limit
+  violations are reported but do not stop the program. The parse queue is not used so that blocks are
+  attributed to the line being parsed. AMASS is disabled, it does not change the step timing but
+  multiplies the number of interrupts to simulate. The run time of the estimator is proportional to
+  the number of step events, about 40 million per second and core.
+
+  NOTE: The time and distance of a stored job run with $FR are accounted to the line with the $FR
+  command. Programs run concurrently share the storage directory, an upload may be seen by another
+  program while in progress.
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdatomic.h>
+#include <strings.h>
+#include <unistd.h>
+#include <dirent.h>
+#include <limits.h>
+#include <pthread.h>
+#include <sys/stat.h>
+
+#include "grbl.h"
+#include "grbllib.h"
+
+#ifndef CORE_INSTANCE_PER_THREAD
+#error "The estimator must be built with CORE_INSTANCE_PER_THREAD defined."
+#endif
+
+#define ESTIMATOR_STEP_TIMER_HZ 20000000UL // Typical ARM step timer clock, only affects rounding of step periods.
+#define ESTIMATOR_ARENA_SIZE (256 * 1024)
+#define ESTIMATOR_BLOCKS 1024 // Blocks in execution, must exceed planner blocks plus segment buffer size. Power of 2.
+#define ESTIMATOR_HISTOGRAM_BINS 11 // Achieved feed in 10% steps of the programmed feed, the last bin for 100%.
+
+typedef struct {
+    uint32_t line;
+    uint32_t steps;      // Step events left to execute.
+    uint64_t cycles;     // Step timer cycles executed.
+    float millimeters;
+    float nominal_speed; // Programmed rate limited by axis max rates, mm/min.
+} estimator_block_t;
+
+typedef struct {
+    FILE *file;
+    uint32_t line;       // Line being parsed, 1 based.
+    uint64_t chars_read;
+    uint64_t chars_at_hook;
+    bool eof;
+    bool cr;             // Previous character was CR.
+    bool terminated;     // Previous character ended a line.
+    bool exit_sent;
+} estimator_input_t;
+
+typedef struct {
+    uint32_t lines_size;
+    double *line_time;   // Seconds per line.
+    float *line_mm;
+    uint32_t last_line;
+    uint64_t n_blocks;
+    double motion_time;  // Seconds.
+    double ideal_time;   // Seconds, all motions at nominal speed.
+    double dwell_time;   // Seconds.
+    double millimeters;
+    double histogram_mm[ESTIMATOR_HISTOGRAM_BINS];
+    double histogram_time[ESTIMATOR_HISTOGRAM_BINS];
+    uint32_t errors;
+    uint32_t first_error_line;
+    char first_error[16];
+    uint32_t soft_limit_violations; // Lines with targets outside the soft limits.
+    uint32_t first_violation_line;
+    uint32_t last_violation_line;
+    bool moved;
+    float min[N_AXIS];   // Bounding box of the motion targets in machine coordinates, mm.
+    float max[N_AXIS];
+    uint32_t pauses;
+} estimator_stats_t;
+
+typedef struct {
+    const char *name;
+    bool opened;
+    uint32_t lines;
+    estimator_stats_t stats;
+} estimator_job_t;
+
+// Machine settings and work offsets, read once and applied to each instance.
+static struct {
+    uint32_t n_settings;
+    uint8_t parameter[256];
+    float value[256];
+    bool coord_set[SETTING_INDEX_NCOORD];
+    float coord_data[SETTING_INDEX_NCOORD][N_AXIS];
+} machine;
+
+static estimator_job_t *jobs = NULL;
+static uint32_t n_jobs = 0;
+static atomic_uint next_job;
+static const char *lines_file = NULL;
+static const char *storage_dir = NULL;
+
+// State of the controller instance run by the current thread.
+static CORE_STATE estimator_job_t *job;
+static CORE_STATE estimator_input_t input = { .terminated = true };
+static CORE_STATE estimator_block_t blocks[ESTIMATOR_BLOCKS];
+static CORE_STATE uint32_t blocks_head = 0, blocks_tail = 0;
+static CORE_STATE uint32_t arena[ESTIMATOR_ARENA_SIZE / sizeof(uint32_t)];
+
+static CORE_STATE struct {
+    bool running;
+    bool prep;
+    uint32_t cycles_per_tick;
+} stepper;
+
+static CORE_STATE FILE *stored_file = NULL;
+static CORE_STATE estimator_stats_t stats;
+static CORE_STATE char output[256];
+static CORE_STATE uint32_t output_length = 0;
+
+// Grows the per-line arrays, kept only when written with -l.
+static void line_stats_reserve (uint32_t line)
+{
+    if (line >= stats.lines_size) {
+        uint32_t size = stats.lines_size ? stats.lines_size : 65536;
+        while (size <= line)
+            size *= 2;
+        stats.line_time = realloc(stats.line_time, size * sizeof(double));
+        stats.line_mm = realloc(stats.line_mm, size * sizeof(float));
+        if (stats.line_time == NULL || stats.line_mm == NULL) {
+            fprintf(stderr, "estimator: out of memory\n");
+            exit(EXIT_FAILURE);
+        }
+        memset(&stats.line_time[stats.lines_size], 0, (size - stats.lines_size) * sizeof(double));
+        memset(&stats.line_mm[stats.lines_size], 0, (size - stats.lines_size) * sizeof(float));
+        stats.lines_size = size;
+    }
+    if (line > stats.last_line)
+        stats.last_line = line;
+}
+
+// Accounts an executed block to its line and the totals.
+static void block_completed (estimator_block_t *block)
+{
+    double time = (double)block->cycles / (double)ESTIMATOR_STEP_TIMER_HZ;
+    double ideal = block->millimeters * 60.0 / block->nominal_speed;
+    uint32_t bin = (uint32_t)((ideal / time) * 10.0);
+
+    if (bin >= ESTIMATOR_HISTOGRAM_BINS)
+        bin = ESTIMATOR_HISTOGRAM_BINS - 1;
+
+    if (lines_file) {
+        line_stats_reserve(block->line);
+        stats.line_time[block->line] += time;
+        stats.line_mm[block->line] += block->millimeters;
+    }
+    stats.n_blocks++;
+    stats.motion_time += time;
+    stats.ideal_time += ideal;
+    stats.millimeters += block->millimeters;
+    stats.histogram_mm[bin] += block->millimeters;
+    stats.histogram_time[bin] += time;
+}
+
+// Records each block added to the planner, in execution order, with the line being parsed. The target
+// is added to the bounding box and checked against the soft limits.
+// NOTE: Linked with --wrap=plan_buffer_line, calls from the core end up here.
+bool __real_plan_buffer_line (float *target, plan_line_data_t *pl_data);
+
+bool __wrap_plan_buffer_line (float *target, plan_line_data_t *pl_data)
+{
+    plan_block_t *block = plan_get_system_motion_block(); // The buffer head, where the new block is stored.
+
+    if (!__real_plan_buffer_line(target, pl_data) || pl_data->condition.system_motion)
+        return false;
+
+    uint_fast8_t idx;
+    estimator_block_t *entry = &blocks[blocks_head];
+
+    for (idx = 0; idx < N_AXIS; idx++) {
+        if (!stats.moved || target[idx] < stats.min[idx])
+            stats.min[idx] = target[idx];
+        if (!stats.moved || target[idx] > stats.max[idx])
+            stats.max[idx] = target[idx];
+    }
+    stats.moved = true;
+
+    if (system_check_travel_limits(target) && stats.last_violation_line != input.line) {
+        if (stats.soft_limit_violations++ == 0)
+            stats.first_violation_line = input.line;
+        stats.last_violation_line = input.line;
+    }
+
+    entry->line = input.line;
+    entry->steps = block->step_event_count;
+    entry->cycles = 0;
+    entry->millimeters = block->millimeters;
+    entry->nominal_speed = min(block->programmed_rate, block->rapid_rate);
+
+    blocks_head = (blocks_head + 1) & (ESTIMATOR_BLOCKS - 1);
+
+    return true;
+}
+
+// Executes one step timer interrupt, segment prep is run when a segment has been loaded.
+inline static void step_tick (void)
+{
+    hal.stepper_interrupt_callback();
+
+    if (stepper.running) {
+        estimator_block_t *block = &blocks[blocks_tail];
+        block->cycles += stepper.cycles_per_tick;
+        if (--block->steps == 0) {
+            block_completed(block);
+            blocks_tail = (blocks_tail + 1) & (ESTIMATOR_BLOCKS - 1);
+        }
+    }
+
+    if (stepper.prep) {
+        stepper.prep = false;
+        st_prep_buffer();
+    }
+}
+
+// The step timer runs while the core waits for motion, i.e. when it is called again without input
+// being read, or at the end of the program. It then runs until a planner block has been prepped
+// and discarded, making room for the next block, or until motion ends. The program ends in the idle
+// state, or in the alarm state after a reset such as by a failed job resume.
+static void host_execute_realtime (uint8_t state)
+{
+    bool input_ended = input.eof && !job_running();
+
+    if (!input_ended && input.chars_read != input.chars_at_hook) {
+        input.chars_at_hook = input.chars_read;
+        return;
+    }
+
+    if (stepper.running) {
+        plan_block_t *block = plan_get_current_block();
+        do {
+            step_tick();
+        } while (stepper.running && (input_ended || block == NULL || plan_get_current_block() == block));
+    } else if (input_ended && !input.exit_sent && (state == STATE_IDLE || state == STATE_ALARM) && plan_get_current_block() == NULL) {
+        input.exit_sent = true;
+        hal.protocol_process_realtime(CMD_EXIT);
+    }
+}
+
+static int32_t host_serial_read (void)
+{
+    int c;
+
+    if (input.eof)
+        return SERIAL_NO_DATA;
+
+    // Realtime commands are not sent by a host streaming a program, drop them.
+    do {
+        c = getc_unlocked(input.file);
+    } while (c == CMD_STATUS_REPORT || c == CMD_CYCLE_START || c == CMD_FEED_HOLD || c == CMD_RESET || c == CMD_EXIT || c > 0x7F);
+
+    if (c == EOF) {
+        input.eof = true;
+        if (input.terminated)
+            return SERIAL_NO_DATA;
+        c = '\n'; // Terminate the last line.
+    }
+
+    // The line number is advanced by the line terminator, which executes the line. LF after CR is ignored.
+    if ((c == '\n' && !input.cr) || c == '\r')
+        input.line++;
+    input.cr = c == '\r';
+    input.terminated = c == '\n' || c == '\r';
+    input.chars_read++;
+
+    return c;
+}
+
+// Output from the core is discarded except for errors, alarms and stored jobs ending with an error.
+static void host_serial_write (uint8_t c)
+{
+    if (c == '\n') {
+        const char *job_status;
+        output[output_length] = '\0';
+        if (!strncmp(output, "error:", 6) || !strncmp(output, "ALARM:", 6) ||
+             (!strncmp(output, "[JOB:", 5) && (job_status = strchr(output, ',')) && strcmp(job_status, ",0]"))) {
+            fprintf(stderr, "%s:%u: %s\n", job->name, input.line, output);
+            if (stats.errors++ == 0) {
+                stats.first_error_line = input.line;
+                snprintf(stats.first_error, sizeof(stats.first_error), "%.*s", (int)sizeof(stats.first_error) - 1, output);
+            }
+        }
+        output_length = 0;
+    } else if (c != '\r' && output_length < sizeof(output) - 1)
+        output[output_length++] = c;
+}
+
+static void host_serial_write_string (const char *s)
+{
+    while (*s)
+    host_serial_write(*s++);
+}
+
+static uint16_t host_serial_get_rx_buffer_available (void)
+{
+    return 1024;
+}
+
+static void host_serial_reset_read_buffer (void)
+{
+}
+
+// Delays with a callback run in the background, e.g. the stepper idle lock time, only blocking delays
+// such as dwells take time.
+static void host_delay_milliseconds (uint32_t ms, void (*callback)(void))
+{
+    if (callback)
+        callback();
+    else {
+        if (lines_file) {
+            line_stats_reserve(input.line);
+            stats.line_time[input.line] += ms / 1000.0;
+        }
+        stats.dwell_time += ms / 1000.0;
+    }
+}
+
+static void host_stepper_wake_up (void)
+{
+    stepper.running = true;
+}
+
+static void host_stepper_go_idle (void)
+{
+    stepper.running = false;
+}
+
+static void host_stepper_cycles_per_tick (uint32_t cycles_per_tick)
+{
+    stepper.cycles_per_tick = cycles_per_tick;
+    stepper.prep = true; // A segment was loaded, there is room for another.
+}
+
+static void host_stepper_enable (bool on)
+{
+}
+
+static void host_stepper_set_outputs (axes_signals_t step_outbits)
+{
+}
+
+static void host_stepper_pulse_start (axes_signals_t dir_outbits, axes_signals_t step_outbits, uint32_t spindle_pwm)
+{
+}
+
+static void host_limits_enable (bool on)
+{
+}
+
+static axes_signals_t host_limits_get_state (void)
+{
+    axes_signals_t signals = {0};
+
+    return signals;
+}
+
+static control_signals_t host_system_control_get_state (void)
+{
+    control_signals_t signals = {0};
+
+    return signals;
+}
+
+static bool host_probe_get_state (void)
+{
+    return false;
+}
+
+static void host_probe_configure_invert_mask (bool is_probe_away)
+{
+}
+
+static void host_coolant_set_state (coolant_state_t mode)
+{
+}
+
+static coolant_state_t host_coolant_get_state (void)
+{
+    coolant_state_t state = {0};
+
+    return state;
+}
+
+static void host_spindle_set_status (spindle_state_t state, float rpm, uint8_t spindle_speed_ovr)
+{
+}
+
+static spindle_state_t host_spindle_get_state (void)
+{
+    spindle_state_t state = {0};
+
+    return state;
+}
+
+static uint32_t host_spindle_set_speed (uint32_t pwm_value)
+{
+    return pwm_value;
+}
+
+static uint32_t host_spindle_compute_pwm_value (float rpm, uint8_t spindle_speed_ovr)
+{
+    return 0;
+}
+
+// Program pauses (M0) set a feed hold after the buffer is synchronized, this is dropped so that the
+// program continues. The operator time is not estimated.
+static void host_set_bits_atomic (volatile uint8_t *value, uint8_t bits)
+{
+    if (value == &sys_rt_exec_state && (bits & EXEC_FEED_HOLD) && gc_state.modal.program_flow == ProgramFlow_Paused) {
+        bits &= ~EXEC_FEED_HOLD;
+        stats.pauses++;
+    }
+
+    *value |= bits;
+}
+
+static uint8_t host_clear_bits_atomic (volatile uint8_t *value, uint8_t bits)
+{
+    uint8_t prev = *value;
+
+    *value &= ~bits;
+
+    return prev;
+}
+
+static uint8_t host_set_value_atomic (volatile uint8_t *value, uint8_t bits)
+{
+    uint8_t prev = *value;
+
+    *value = bits;
+
+    return prev;
+}
+
+static void host_settings_changed (settings_t *settings)
+{
+}
+
+// Job storage in the -d directory, file names may not leave it.
+static bool host_file_path (char *path, const char *name)
+{
+    if (strchr(name, '/') || !strcmp(name, ".") || !strcmp(name, ".."))
+        return false;
+
+    return snprintf(path, PATH_MAX, "%s/%s", storage_dir, name) < PATH_MAX;
+}
+
+static bool host_file_open (const char *name, file_mode_t mode)
+{
+    char path[PATH_MAX];
+
+    if (stored_file)
+        fclose(stored_file);
+
+    stored_file = host_file_path(path, name) ? fopen(path, mode == FileMode_Write ? "w" : "r") : NULL;
+
+    return stored_file != NULL;
+}
+
+// Returns a character at a time, so that the step timer runs while a job is read as while a program
+// is streamed, see host_execute_realtime().
+static int32_t host_file_read (uint8_t *data, uint32_t size)
+{
+    int c;
+
+    if (stored_file == NULL || size == 0)
+        return -1;
+
+    if ((c = getc_unlocked(stored_file)) == EOF)
+        return ferror(stored_file) ? -1 : 0;
+
+    *data = (uint8_t)c;
+    input.chars_read++;
+
+    return 1;
+}
+
+static bool host_file_write (const uint8_t *data, uint32_t size)
+{
+    return stored_file != NULL && fwrite(data, 1, size, stored_file) == size;
+}
+
+static void host_file_close (void)
+{
+    if (stored_file) {
+        fclose(stored_file);
+        stored_file = NULL;
+    }
+}
+
+static bool host_file_remove (const char *name)
+{
+    char path[PATH_MAX];
+
+    return host_file_path(path, name) && unlink(path) == 0;
+}
+
+// Lists the regular files with names that fit, in directory order.
+static bool host_file_list (uint32_t idx, char *name, uint32_t *size)
+{
+    DIR *dir;
+    struct dirent *entry;
+    struct stat info;
+    char path[PATH_MAX];
+    bool found = false;
+
+    if ((dir = opendir(storage_dir)) == NULL)
+        return false;
+
+    while (!found && (entry = readdir(dir))) {
+        if (strlen(entry->d_name) <= JOB_FILENAME_LENGTH && host_file_path(path, entry->d_name) &&
+             !stat(path, &info) && S_ISREG(info.st_mode) && idx-- == 0) {
+            strcpy(name, entry->d_name);
+            *size = (uint32_t)info.st_size;
+            found = true;
+        }
+    }
+
+    closedir(dir);
+
+    return found;
+}
+
+// Applies the machine settings and work offsets and disables what the estimator can not simulate.
+// Settings that are rejected are reported by the first job only.
+static bool driver_setup (settings_t *settings)
+{
+    uint32_t idx;
+
+    for (idx = 0; idx < machine.n_settings; idx++) {
+        status_code_t status = settings_store_global_setting(machine.parameter[idx], machine.value[idx]);
+        if (status != Status_OK && job == jobs)
+            fprintf(stderr, "estimator: $%u=%g not applied (error:%d)\n", machine.parameter[idx], machine.value[idx], (int)status);
+    }
+
+    for (idx = 0; idx < SETTING_INDEX_NCOORD; idx++) {
+        if (machine.coord_set[idx]) {
+            float coord_data[N_AXIS];
+            uint_fast8_t axis;
+            for (axis = 0; axis < N_AXIS; axis++)
+                coord_data[axis] = settings->flags.report_inches ? machine.coord_data[idx][axis] * MM_PER_INCH : machine.coord_data[idx][axis];
+            settings_write_coord_data(idx, coord_data);
+        }
+    }
+
+    settings->flags.homing_enable = off;
+    settings->flags.hard_limit_enable = off;
+    settings->flags.soft_limit_enable = off;
+    settings->parse_queue_size = 0;
+
+    return true;
+}
+
+static bool driver_release (void)
+{
+    return false;
+}
+
+bool driver_init (void)
+{
+    if (hal.version != 5) // HAL built for another version of the core.
+        return false;
+
+    hal.f_step_timer = ESTIMATOR_STEP_TIMER_HZ;
+    hal.rx_buffer_size = 1024;
+    hal.arena = (uint8_t *)arena;
+    hal.arena_size = sizeof(arena);
+
+    hal.driver_setup = driver_setup;
+    hal.driver_release = driver_release;
+    hal.execute_realtime = host_execute_realtime;
+
+    hal.limits_enable = host_limits_enable;
+    hal.limits_get_state = host_limits_get_state;
+    hal.coolant_set_state = host_coolant_set_state;
+    hal.coolant_get_state = host_coolant_get_state;
+    hal.delay_milliseconds = host_delay_milliseconds;
+
+    hal.probe_get_state = host_probe_get_state;
+    hal.probe_configure_invert_mask = host_probe_configure_invert_mask;
+
+    hal.spindle_set_status = host_spindle_set_status;
+    hal.spindle_get_state = host_spindle_get_state;
+    hal.spindle_set_speed = host_spindle_set_speed;
+    hal.spindle_compute_pwm_value = host_spindle_compute_pwm_value;
+    hal.system_control_get_state = host_system_control_get_state;
+
+    hal.stepper_wake_up = host_stepper_wake_up;
+    hal.stepper_go_idle = host_stepper_go_idle;
+    hal.stepper_enable = host_stepper_enable;
+    hal.stepper_set_outputs = host_stepper_set_outputs;
+    hal.stepper_set_directions = host_stepper_set_outputs;
+    hal.stepper_cycles_per_tick = host_stepper_cycles_per_tick;
+    hal.stepper_pulse_start = host_stepper_pulse_start;
+
+    hal.serial_get_rx_buffer_available = host_serial_get_rx_buffer_available;
+    hal.serial_write = host_serial_write;
+    hal.serial_write_string = host_serial_write_string;
+    hal.serial_read = host_serial_read;
+    hal.serial_reset_read_buffer = host_serial_reset_read_buffer;
+    hal.serial_cancel_read_buffer = host_serial_reset_read_buffer;
+
+    hal.set_bits_atomic = host_set_bits_atomic;
+    hal.clear_bits_atomic = host_clear_bits_atomic;
+    hal.set_value_atomic = host_set_value_atomic;
+
+    hal.settings_changed = host_settings_changed;
+
+    if (storage_dir) {
+        hal.file.open = host_file_open;
+        hal.file.read = host_file_read;
+        hal.file.write = host_file_write;
+        hal.file.close = host_file_close;
+        hal.file.remove = host_file_remove;
+        hal.file.list = host_file_list;
+    }
+
+    hal.eeprom.type = EEPROM_None;
+
+    hal.driver_cap.mist_control = on;
+    hal.driver_cap.variable_spindle = on;
+    hal.driver_cap.spindle_dir = on;
+    hal.driver_cap.software_debounce = on;
+    hal.driver_cap.safety_door = on;
+    hal.driver_cap.stepper_current_control = on;
+    hal.driver_cap.amass_level = 0;
+
+    return true;
+}
+
+static void print_time (const char *label, double seconds)
+{
+    printf("%-26s %02u:%02u:%06.3f  %10.3f s\n", label, (unsigned int)(seconds / 3600.0),
+            (unsigned int)(seconds / 60.0) % 60, fmod(seconds, 60.0), seconds);
+}
+
+static void report (estimator_job_t *job)
+{
+    uint32_t bin;
+    uint_fast8_t idx;
+    estimator_stats_t *stats = &job->stats;
+    double total = stats->motion_time + stats->dwell_time;
+
+    printf("Lines                      %u\n", job->lines);
+    printf("Blocks                     %llu\n", (unsigned long long)stats->n_blocks);
+    printf("Distance                   %.3f mm\n", stats->millimeters);
+    print_time("Run time", total);
+    print_time("Motion", stats->motion_time);
+    print_time("Dwell", stats->dwell_time);
+    print_time("Lost to acceleration", stats->motion_time - stats->ideal_time);
+    if (stats->pauses)
+        printf("Program pauses (M0)        %u, not included\n", stats->pauses);
+    if (stats->errors)
+        printf("Errors and alarms          %u, first at line %u\n", stats->errors, stats->first_error_line);
+    if (stats->soft_limit_violations)
+        printf("Soft limit violations      %u lines, first at line %u\n", stats->soft_limit_violations, stats->first_violation_line);
+
+    if (stats->moved) {
+        printf("\nMachine coordinates             min          max\n");
+        for (idx = 0; idx < N_AXIS; idx++)
+            printf("                   %c   %12.3f %12.3f\n", "XYZABC"[idx], stats->min[idx], stats->max[idx]);
+    }
+
+    printf("\nAchieved/programmed feed   distance       time\n");
+    for (bin = 0; bin < ESTIMATOR_HISTOGRAM_BINS; bin++) {
+        if (bin == ESTIMATOR_HISTOGRAM_BINS - 1)
+            printf("              100%%");
+        else
+            printf("         %3u-%3u%%", bin * 10, bin * 10 + 10);
+        printf("      %6.2f%%    %6.2f%%\n",
+                stats->millimeters > 0.0 ? 100.0 * stats->histogram_mm[bin] / stats->millimeters : 0.0,
+                stats->motion_time > 0.0 ? 100.0 * stats->histogram_time[bin] / stats->motion_time : 0.0);
+    }
+}
+
+static void write_line_stats (const char *name)
+{
+    FILE *file;
+    uint32_t line;
+
+    if ((file = fopen(name, "w")) == NULL) {
+        perror(name);
+        exit(EXIT_FAILURE);
+    }
+
+    fprintf(file, "line,seconds,mm\n");
+
+    for (line = 1; line <= stats.last_line; line++) {
+        if (stats.line_time[line] > 0.0)
+            fprintf(file, "%u,%.6f,%.4f\n", line, stats.line_time[line], stats.line_mm[line]);
+    }
+
+    fclose(file);
+}
+
+// Writes a file name as a CSV field, quoted if needed.
+static void write_csv_name (FILE *file, const char *name)
+{
+    if (strpbrk(name, ",\"\r\n") == NULL)
+        fputs(name, file);
+    else {
+        fputc('"', file);
+        for (; *name; name++) {
+            if (*name == '"')
+                fputc('"', file);
+            fputc(*name, file);
+        }
+        fputc('"', file);
+    }
+}
+
+static void write_results (const char *name)
+{
+    FILE *file;
+    uint32_t idx;
+    uint_fast8_t axis;
+
+    if ((file = fopen(name, "w")) == NULL) {
+        perror(name);
+        exit(EXIT_FAILURE);
+    }
+
+    fprintf(file, "file,lines,blocks,mm,seconds,motion,dwell,errors,first_error_line,first_error,soft_limit_violations,first_violation_line");
+    for (axis = 0; axis < N_AXIS; axis++)
+        fprintf(file, ",%c_min,%c_max", "xyzabc"[axis], "xyzabc"[axis]);
+    fputc('\n', file);
+
+    for (idx = 0; idx < n_jobs; idx++) {
+        estimator_stats_t *stats = &jobs[idx].stats;
+        write_csv_name(file, jobs[idx].name);
+        if (!jobs[idx].opened) {
+            fprintf(file, ",,,,,,,1,0,open failed,,\n");
+            continue;
+        }
+        fprintf(file, ",%u,%llu,%.3f,%.3f,%.3f,%.3f,%u,%u,%s,%u,%u", jobs[idx].lines, (unsigned long long)stats->n_blocks,
+                 stats->millimeters, stats->motion_time + stats->dwell_time, stats->motion_time, stats->dwell_time,
+                  stats->errors, stats->first_error_line, stats->first_error, stats->soft_limit_violations, stats->first_violation_line);
+        for (axis = 0; axis < N_AXIS; axis++) {
+            if (stats->moved)
+                fprintf(file, ",%.3f,%.3f", stats->min[axis], stats->max[axis]);
+            else
+                fprintf(file, ",,");
+        }
+        fputc('\n', file);
+    }
+
+    fclose(file);
+}
+
+// Reads the machine settings from a $$ listing and the work offsets from a $# listing.
+static void read_settings (const char *name)
+{
+    FILE *file;
+    char line[LINE_BUFFER_SIZE], code[4];
+    unsigned int parameter;
+    float value;
+    int pos;
+
+    if ((file = fopen(name, "r")) == NULL) {
+        perror(name);
+        exit(EXIT_FAILURE);
+    }
+
+    while (fgets(line, sizeof(line), file)) {
+        if (sscanf(line, " $%u=%f", &parameter, &value) == 2 && parameter < 256) {
+            if (machine.n_settings < sizeof(machine.parameter)) {
+                machine.parameter[machine.n_settings] = (uint8_t)parameter;
+                machine.value[machine.n_settings++] = value;
+            }
+        } else if (sscanf(line, " [%3[G0-9]:%n", code, &pos) == 1) {
+            uint32_t idx, axis;
+            if (!strcmp(code, "G28"))
+                idx = SETTING_INDEX_G28;
+            else if (!strcmp(code, "G30"))
+                idx = SETTING_INDEX_G30;
+            else if (code[0] == 'G' && (idx = (uint32_t)atoi(&code[1]) - 54) < N_COORDINATE_SYSTEM)
+                ;
+            else
+                continue; // G92 and TLO are not persistent.
+            char *s = &line[pos], *end;
+            for (axis = 0; axis < N_AXIS; axis++) {
+                machine.coord_data[idx][axis] = strtof(s, &end);
+                if (end == s)
+                    break;
+                s = *end == ',' ? end + 1 : end;
+            }
+            machine.coord_set[idx] = axis == N_AXIS;
+        }
+    }
+
+    fclose(file);
+}
+
+static bool is_gcode_file (const char *name)
+{
+    static const char *extensions[] = { ".nc", ".ngc", ".gcode", ".gc", ".tap", ".cnc" };
+    const char *ext = strrchr(name, '.');
+    uint32_t idx;
+
+    if (ext) for (idx = 0; idx < sizeof(extensions) / sizeof(extensions[0]); idx++) {
+        if (!strcasecmp(ext, extensions[idx]))
+            return true;
+    }
+
+    return false;
+}
+
+static void add_job (const char *name)
+{
+    if ((n_jobs & 1023) == 0 && (jobs = realloc(jobs, (n_jobs + 1024) * sizeof(estimator_job_t))) == NULL) {
+        fprintf(stderr, "estimator: out of memory\n");
+        exit(EXIT_FAILURE);
+    }
+
+    memset(&jobs[n_jobs], 0, sizeof(estimator_job_t));
+    jobs[n_jobs++].name = name;
+}
+
+static int compare_jobs (const void *a, const void *b)
+{
+    return strcmp(((const estimator_job_t *)a)->name, ((const estimator_job_t *)b)->name);
+}
+
+// Adds a program, or the g-code files in a directory sorted by name.
+static void add_jobs (const char *name)
+{
+    DIR *dir;
+    struct dirent *entry;
+    struct stat info;
+    uint32_t first = n_jobs;
+
+    if (stat(name, &info) || !S_ISDIR(info.st_mode)) {
+        add_job(name);
+        return;
+    }
+
+    if ((dir = opendir(name)) == NULL) {
+        perror(name);
+        exit(EXIT_FAILURE);
+    }
+
+    while ((entry = readdir(dir))) {
+        if (is_gcode_file(entry->d_name)) {
+            char *path = malloc(strlen(name) + strlen(entry->d_name) + 2);
+            if (path == NULL) {
+                fprintf(stderr, "estimator: out of memory\n");
+                exit(EXIT_FAILURE);
+            }
+            sprintf(path, "%s/%s", name, entry->d_name);
+            if (!stat(path, &info) && S_ISREG(info.st_mode))
+                add_job(path);
+            else
+                free(path);
+        }
+    }
+
+    closedir(dir);
+
+    qsort(&jobs[first], n_jobs - first, sizeof(estimator_job_t), compare_jobs);
+}
+
+// Runs a program by a controller instance of its own.
+static void *estimate (void *arg)
+{
+    job = (estimator_job_t *)arg;
+
+    if ((input.file = fopen(job->name, "r")) == NULL) {
+        perror(job->name);
+        return NULL;
+    }
+
+    job->opened = true;
+
+    if (lines_file)
+        line_stats_reserve(0);
+
+    grbl_enter();
+
+    fclose(input.file);
+    host_file_close();
+
+    if (lines_file)
+        write_line_stats(lines_file);
+
+    job->lines = input.line;
+    job->stats = stats;
+    job->stats.line_time = NULL;
+    job->stats.line_mm = NULL;
+
+    free(stats.line_time);
+    free(stats.line_mm);
+
+    return NULL;
+}
+
+static void *worker (void *arg)
+{
+    uint32_t idx;
+    pthread_t thread;
+
+    // Each program is run in a new thread so that it starts from freshly initialized core state.
+    while ((idx = atomic_fetch_add(&next_job, 1)) < n_jobs) {
+        if (pthread_create(&thread, NULL, estimate, &jobs[idx])) {
+            perror("estimator");
+            exit(EXIT_FAILURE);
+        }
+        pthread_join(thread, NULL);
+    }
+
+    return NULL;
+}
+
+static void usage (const char *name)
+{
+    fprintf(stderr, "Usage: %s [-s settings.txt] [-l lines.csv] [-j jobs] [-o results.csv] [-d storage] program.nc|directory...\n", name);
+}
+
+int main (int argc, char **argv)
+{
+    int opt;
+    uint32_t idx, n_workers = 0, failed = 0, violating = 0;
+    double total = 0.0;
+    const char *results_file = NULL;
+    pthread_t *workers;
+
+    while ((opt = getopt(argc, argv, "s:l:j:o:d:")) != -1) {
+        switch (opt) {
+
+            case 's':
+                read_settings(optarg);
+                break;
+
+            case 'l':
+                lines_file = optarg;
+                break;
+
+            case 'j':
+                n_workers = (uint32_t)atoi(optarg);
+                break;
+
+            case 'o':
+                results_file = optarg;
+                break;
+
+            case 'd':
+                storage_dir = optarg;
+                break;
+
+            default:
+                usage(argv[0]);
+                return EXIT_FAILURE;
+        }
+    }
+
+    if (optind == argc) {
+        usage(argv[0]);
+        return EXIT_FAILURE;
+    }
+
+    for (idx = optind; idx < (uint32_t)argc; idx++)
+        add_jobs(argv[idx]);
+
+    if (n_jobs == 0) {
+        fprintf(stderr, "estimator: no g-code files\n");
+        return EXIT_FAILURE;
+    }
+
+    if (lines_file && n_jobs > 1) {
+        fprintf(stderr, "estimator: -l requires a single program\n");
+        return EXIT_FAILURE;
+    }
+
+    if (n_workers == 0)
+        n_workers = (uint32_t)sysconf(_SC_NPROCESSORS_ONLN);
+    if (n_workers > n_jobs)
+        n_workers = n_jobs;
+
+    if ((workers = malloc(n_workers * sizeof(pthread_t))) == NULL) {
+        fprintf(stderr, "estimator: out of memory\n");
+        return EXIT_FAILURE;
+    }
+
+    atomic_init(&next_job, 0);
+
+    for (idx = 0; idx < n_workers; idx++) {
+        if (pthread_create(&workers[idx], NULL, worker, NULL)) {
+            perror("estimator");
+            return EXIT_FAILURE;
+        }
+    }
+
+    for (idx = 0; idx < n_workers; idx++)
+        pthread_join(workers[idx], NULL);
+
+    if (n_jobs == 1 && jobs[0].opened)
+        report(&jobs[0]);
+    else for (idx = 0; idx < n_jobs; idx++) {
+        estimator_stats_t *stats = &jobs[idx].stats;
+        if (!jobs[idx].opened) {
+            printf("%s: could not be opened\n", jobs[idx].name);
+            continue;
+        }
+        printf("%s: %02u:%02u:%06.3f, %u errors, %u soft limit violations\n", jobs[idx].name,
+                (unsigned int)((stats->motion_time + stats->dwell_time) / 3600.0),
+                 (unsigned int)((stats->motion_time + stats->dwell_time) / 60.0) % 60,
+                  fmod(stats->motion_time + stats->dwell_time, 60.0), stats->errors, stats->soft_limit_violations);
+    }
+
+    for (idx = 0; idx < n_jobs; idx++) {
+        if (!jobs[idx].opened || jobs[idx].stats.errors)
+            failed++;
+        if (jobs[idx].stats.soft_limit_violations)
+            violating++;
+        total += jobs[idx].stats.motion_time + jobs[idx].stats.dwell_time;
+    }
+
+    if (n_jobs > 1) {
+        printf("\n%u programs, %u with errors, %u with soft limit violations\n", n_jobs, failed, violating);
+        print_time("Total run time", total);
+    }
+
+    if (results_file)
+        write_results(results_file);
+
+    return failed || violating ? 2 : EXIT_SUCCESS;
+}
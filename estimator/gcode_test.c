@@ -0,0 +1,535 @@
+/*
+  gcode_test.c - equivalence test of the g-code parser fast path
+  Part of Grbl
+
+  Copyright (c) 2017 Terje Io
+
+  Grbl is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  Grbl is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with Grbl.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+/*
+  A host driver that streams g-code programs through the unmodified Grbl core and records a trace of
+  the responses, every block passed to the planner and a checksum of the parser state after each line.
+  The test is built twice, with the parser fast path as configured by GCODE_FAST_PATH in config.h and
+  with the full parser only, and the traces of the two builds must be identical for any program.
+  The reference build compiles gcode.c into this file with GCODE_FAST_PATH undefined.
+
+  Build on the host from the repository root, or run gcode_test.sh which builds both and compares:
+
+    gcc -O2 -std=gnu11 -funsigned-char -pthread -DCORE_INSTANCE_PER_THREAD -Igrbl -Wl,--wrap=plan_buffer_line -o build/gcode_test estimator/gcode_test.c grbl/[a-z]*.c -lm
+    gcc -O2 -std=gnu11 -funsigned-char -pthread -DCORE_INSTANCE_PER_THREAD -DGCODE_TEST_REFERENCE -Igrbl -Wl,--wrap=plan_buffer_line -o build/gcode_test_ref estimator/gcode_test.c $(ls grbl/[a-z]*.c | grep -v /gcode.c) -lm
+
+  Usage: gcode_test [-t] program.nc|directory...
+
+    -t  print the full trace instead of a checksum per program, to find where two builds differ.
+
+  Directories are expanded to the g-code files (.nc, .ngc, .gcode, .gc, .tap and .cnc) they contain.
+  A line per program is printed with the number of lines, planner blocks and errors and the trace
+  checksum. The number of lines executed by the fast path is printed to stderr.
+
+  The programs in estimator/cases have known results, gcode_test.sh checks their traces against the
+  expected .trace files, which are the output of gcode_test -t.
+
+  NOTE: Blocks are recorded and dropped instead of planned, so the programs run at parser speed.
+  Settings are the defaults from defaults.h, M0 program pauses resume immediately.
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <strings.h>
+#include <unistd.h>
+#include <dirent.h>
+#include <pthread.h>
+#include <sys/stat.h>
+
+#include "grbl.h"
+
+#ifdef GCODE_TEST_REFERENCE
+#undef GCODE_FAST_PATH
+#include "../grbl/gcode.c"
+#endif
+
+#include "grbllib.h"
+
+#ifndef CORE_INSTANCE_PER_THREAD
+#error "The g-code test must be built with CORE_INSTANCE_PER_THREAD defined."
+#endif
+
+#define GCODE_TEST_ARENA_SIZE (256 * 1024)
+#define GCODE_TEST_UNPARSED (-1) // gc_block.values.n before a line is executed, only the full parser clears it.
+
+typedef struct {
+    const char *name;
+    bool opened;
+    uint32_t lines;
+    uint64_t blocks;
+    uint32_t errors;
+    uint32_t fast_lines; // Lines with motion executed by the fast path.
+    uint64_t checksum;
+} test_program_t;
+
+extern CORE_STATE parser_block_t gc_block;
+
+static bool print_trace = false;
+
+// State of the controller instance run by the current thread.
+static CORE_STATE test_program_t *program;
+static CORE_STATE FILE *input;
+static CORE_STATE bool eof = false, cr = false, terminated = true, exit_sent = false;
+static CORE_STATE uint64_t line_blocks = 0;
+static CORE_STATE uint32_t arena[GCODE_TEST_ARENA_SIZE / sizeof(uint32_t)];
+static CORE_STATE char output[256];
+static CORE_STATE uint32_t output_length = 0;
+
+// 64-bit FNV-1a
+static void trace_hash (const void *data, size_t size)
+{
+    const uint8_t *byte = (const uint8_t *)data;
+
+    while (size--)
+        program->checksum = (program->checksum ^ *byte++) * 0x100000001B3ULL;
+}
+
+// Records each block passed to the planner and drops it, the planner buffer is kept empty.
+// NOTE: Linked with --wrap=plan_buffer_line, calls from the core end up here.
+bool __wrap_plan_buffer_line (float *target, plan_line_data_t *pl_data)
+{
+    trace_hash(target, sizeof(float) * N_AXIS);
+    trace_hash(pl_data, sizeof(plan_line_data_t));
+
+    if (print_trace) {
+        uint_fast8_t idx;
+        printf("%u: block", program->lines);
+        for (idx = 0; idx < N_AXIS; idx++)
+            printf(" %a", target[idx]);
+        printf(" F%a S%a C%x\n", pl_data->feed_rate, pl_data->spindle_speed, (unsigned int)pl_data->condition.value);
+    }
+
+    program->blocks++;
+    line_blocks++;
+
+    return true;
+}
+
+static void host_execute_realtime (uint8_t state)
+{
+    if (eof && !exit_sent) {
+        exit_sent = true;
+        hal.protocol_process_realtime(CMD_EXIT);
+    }
+}
+
+static int32_t host_serial_read (void)
+{
+    int c;
+
+    if (eof)
+        return SERIAL_NO_DATA;
+
+    // Realtime commands are not sent by a host streaming a program, drop them.
+    do {
+        c = getc_unlocked(input);
+    } while (c == CMD_STATUS_REPORT || c == CMD_CYCLE_START || c == CMD_FEED_HOLD || c == CMD_RESET || c == CMD_EXIT || c > 0x7F);
+
+    if (c == EOF) {
+        eof = true;
+        if (terminated)
+            return SERIAL_NO_DATA;
+        c = '\n'; // Terminate the last line.
+    }
+
+    // The line terminator executes the line. LF after CR is ignored.
+    if ((c == '\n' && !cr) || c == '\r') {
+        program->lines++;
+        line_blocks = 0;
+        gc_block.values.n = GCODE_TEST_UNPARSED;
+    }
+    cr = c == '\r';
+    terminated = c == '\n' || c == '\r';
+
+    return c;
+}
+
+// Responses are added to the trace, followed by the parser state for ok and error responses.
+static void host_serial_write (uint8_t c)
+{
+    if (c == '\n') {
+        output[output_length] = '\0';
+        trace_hash(output, output_length);
+        if (print_trace)
+            printf("%u: %s\n", program->lines, output);
+        if (!strncmp(output, "ok", 2) || !strncmp(output, "error:", 6)) {
+            trace_hash(&gc_state, sizeof(parser_state_t));
+            if (output[0] == 'e')
+                program->errors++;
+            else if (line_blocks && gc_block.values.n == GCODE_TEST_UNPARSED)
+                program->fast_lines++;
+        }
+        output_length = 0;
+    } else if (c != '\r' && output_length < sizeof(output) - 1)
+        output[output_length++] = c;
+}
+
+static void host_serial_write_string (const char *s)
+{
+    while (*s)
+        host_serial_write(*s++);
+}
+
+static uint16_t host_serial_get_rx_buffer_available (void)
+{
+    return 1024;
+}
+
+static void host_serial_reset_read_buffer (void)
+{
+}
+
+static void host_delay_milliseconds (uint32_t ms, void (*callback)(void))
+{
+    if (callback)
+        callback();
+}
+
+static void host_stepper_wake_up (void)
+{
+}
+
+static void host_stepper_go_idle (void)
+{
+}
+
+static void host_stepper_cycles_per_tick (uint32_t cycles_per_tick)
+{
+}
+
+static void host_stepper_enable (bool on)
+{
+}
+
+static void host_stepper_set_outputs (axes_signals_t step_outbits)
+{
+}
+
+static void host_stepper_pulse_start (axes_signals_t dir_outbits, axes_signals_t step_outbits, uint32_t spindle_pwm)
+{
+}
+
+static void host_limits_enable (bool on)
+{
+}
+
+static axes_signals_t host_limits_get_state (void)
+{
+    axes_signals_t signals = {0};
+
+    return signals;
+}
+
+static control_signals_t host_system_control_get_state (void)
+{
+    control_signals_t signals = {0};
+
+    return signals;
+}
+
+static bool host_probe_get_state (void)
+{
+    return false;
+}
+
+static void host_probe_configure_invert_mask (bool is_probe_away)
+{
+}
+
+static void host_coolant_set_state (coolant_state_t mode)
+{
+}
+
+static coolant_state_t host_coolant_get_state (void)
+{
+    coolant_state_t state = {0};
+
+    return state;
+}
+
+static void host_spindle_set_status (spindle_state_t state, float rpm, uint8_t spindle_speed_ovr)
+{
+}
+
+static spindle_state_t host_spindle_get_state (void)
+{
+    spindle_state_t state = {0};
+
+    return state;
+}
+
+static uint32_t host_spindle_set_speed (uint32_t pwm_value)
+{
+    return pwm_value;
+}
+
+static uint32_t host_spindle_compute_pwm_value (float rpm, uint8_t spindle_speed_ovr)
+{
+    return 0;
+}
+
+// Program pauses (M0) set a feed hold after the buffer is synchronized, this is dropped so that the
+// program continues.
+static void host_set_bits_atomic (volatile uint8_t *value, uint8_t bits)
+{
+    if (value == &sys_rt_exec_state && (bits & EXEC_FEED_HOLD) && gc_state.modal.program_flow == ProgramFlow_Paused)
+        bits &= ~EXEC_FEED_HOLD;
+
+    *value |= bits;
+}
+
+static uint8_t host_clear_bits_atomic (volatile uint8_t *value, uint8_t bits)
+{
+    uint8_t prev = *value;
+
+    *value &= ~bits;
+
+    return prev;
+}
+
+static uint8_t host_set_value_atomic (volatile uint8_t *value, uint8_t bits)
+{
+    uint8_t prev = *value;
+
+    *value = bits;
+
+    return prev;
+}
+
+static void host_settings_changed (settings_t *settings)
+{
+}
+
+static bool driver_setup (settings_t *settings)
+{
+    settings->flags.homing_enable = off;
+    settings->flags.hard_limit_enable = off;
+    settings->flags.soft_limit_enable = off;
+    settings->parse_queue_size = 0;
+
+    return true;
+}
+
+static bool driver_release (void)
+{
+    return false;
+}
+
+bool driver_init (void)
+{
+    if (hal.version != 5) // HAL built for another version of the core.
+        return false;
+
+    hal.f_step_timer = 20000000UL;
+    hal.rx_buffer_size = 1024;
+    hal.arena = (uint8_t *)arena;
+    hal.arena_size = sizeof(arena);
+
+    hal.driver_setup = driver_setup;
+    hal.driver_release = driver_release;
+    hal.execute_realtime = host_execute_realtime;
+
+    hal.limits_enable = host_limits_enable;
+    hal.limits_get_state = host_limits_get_state;
+    hal.coolant_set_state = host_coolant_set_state;
+    hal.coolant_get_state = host_coolant_get_state;
+    hal.delay_milliseconds = host_delay_milliseconds;
+
+    hal.probe_get_state = host_probe_get_state;
+    hal.probe_configure_invert_mask = host_probe_configure_invert_mask;
+
+    hal.spindle_set_status = host_spindle_set_status;
+    hal.spindle_get_state = host_spindle_get_state;
+    hal.spindle_set_speed = host_spindle_set_speed;
+    hal.spindle_compute_pwm_value = host_spindle_compute_pwm_value;
+    hal.system_control_get_state = host_system_control_get_state;
+
+    hal.stepper_wake_up = host_stepper_wake_up;
+    hal.stepper_go_idle = host_stepper_go_idle;
+    hal.stepper_enable = host_stepper_enable;
+    hal.stepper_set_outputs = host_stepper_set_outputs;
+    hal.stepper_set_directions = host_stepper_set_outputs;
+    hal.stepper_cycles_per_tick = host_stepper_cycles_per_tick;
+    hal.stepper_pulse_start = host_stepper_pulse_start;
+
+    hal.serial_get_rx_buffer_available = host_serial_get_rx_buffer_available;
+    hal.serial_write = host_serial_write;
+    hal.serial_write_string = host_serial_write_string;
+    hal.serial_read = host_serial_read;
+    hal.serial_reset_read_buffer = host_serial_reset_read_buffer;
+    hal.serial_cancel_read_buffer = host_serial_reset_read_buffer;
+
+    hal.set_bits_atomic = host_set_bits_atomic;
+    hal.clear_bits_atomic = host_clear_bits_atomic;
+    hal.set_value_atomic = host_set_value_atomic;
+
+    hal.settings_changed = host_settings_changed;
+
+    hal.eeprom.type = EEPROM_None;
+
+    hal.driver_cap.mist_control = on;
+    hal.driver_cap.variable_spindle = on;
+    hal.driver_cap.spindle_dir = on;
+    hal.driver_cap.software_debounce = on;
+    hal.driver_cap.safety_door = on;
+    hal.driver_cap.stepper_current_control = on;
+    hal.driver_cap.amass_level = 0;
+
+    return true;
+}
+
+static test_program_t *programs = NULL;
+static uint32_t n_programs = 0;
+
+static bool is_gcode_file (const char *name)
+{
+    static const char *extensions[] = { ".nc", ".ngc", ".gcode", ".gc", ".tap", ".cnc" };
+    const char *ext = strrchr(name, '.');
+    uint32_t idx;
+
+    if (ext) for (idx = 0; idx < sizeof(extensions) / sizeof(extensions[0]); idx++) {
+        if (!strcasecmp(ext, extensions[idx]))
+            return true;
+    }
+
+    return false;
+}
+
+static void add_program (const char *name)
+{
+    if ((n_programs & 1023) == 0 && (programs = realloc(programs, (n_programs + 1024) * sizeof(test_program_t))) == NULL) {
+        fprintf(stderr, "gcode_test: out of memory\n");
+        exit(EXIT_FAILURE);
+    }
+
+    memset(&programs[n_programs], 0, sizeof(test_program_t));
+    programs[n_programs++].name = name;
+}
+
+static int compare_programs (const void *a, const void *b)
+{
+    return strcmp(((const test_program_t *)a)->name, ((const test_program_t *)b)->name);
+}
+
+// Adds a program, or the g-code files in a directory sorted by name.
+static void add_programs (const char *name)
+{
+    DIR *dir;
+    struct dirent *entry;
+    struct stat info;
+    uint32_t first = n_programs;
+
+    if (stat(name, &info) || !S_ISDIR(info.st_mode)) {
+        add_program(name);
+        return;
+    }
+
+    if ((dir = opendir(name)) == NULL) {
+        perror(name);
+        exit(EXIT_FAILURE);
+    }
+
+    while ((entry = readdir(dir))) {
+        if (is_gcode_file(entry->d_name)) {
+            char *path = malloc(strlen(name) + strlen(entry->d_name) + 2);
+            if (path == NULL) {
+                fprintf(stderr, "gcode_test: out of memory\n");
+                exit(EXIT_FAILURE);
+            }
+            sprintf(path, "%s/%s", name, entry->d_name);
+            if (!stat(path, &info) && S_ISREG(info.st_mode))
+                add_program(path);
+            else
+                free(path);
+        }
+    }
+
+    closedir(dir);
+
+    qsort(&programs[first], n_programs - first, sizeof(test_program_t), compare_programs);
+}
+
+// Runs a program by a controller instance of its own.
+static void *run (void *arg)
+{
+    program = (test_program_t *)arg;
+    program->checksum = 0xCBF29CE484222325ULL;
+
+    if ((input = fopen(program->name, "r")) == NULL) {
+        perror(program->name);
+        return NULL;
+    }
+
+    program->opened = true;
+
+    grbl_enter();
+
+    fclose(input);
+
+    return NULL;
+}
+
+int main (int argc, char **argv)
+{
+    int opt;
+    uint32_t idx, failed = 0;
+    uint64_t lines = 0, fast_lines = 0;
+    pthread_t thread;
+
+    while ((opt = getopt(argc, argv, "t")) != -1) {
+        if (opt == 't')
+            print_trace = true;
+        else {
+            fprintf(stderr, "Usage: %s [-t] program.nc|directory...\n", argv[0]);
+            return EXIT_FAILURE;
+        }
+    }
+
+    for (idx = optind; idx < (uint32_t)argc; idx++)
+        add_programs(argv[idx]);
+
+    if (n_programs == 0) {
+        fprintf(stderr, "Usage: %s [-t] program.nc|directory...\n", argv[0]);
+        return EXIT_FAILURE;
+    }
+
+    // Each program is run in a new thread so that it starts from freshly initialized core state.
+    for (idx = 0; idx < n_programs; idx++) {
+        if (print_trace)
+            printf("== %s\n", programs[idx].name);
+        if (pthread_create(&thread, NULL, run, &programs[idx])) {
+            perror("gcode_test");
+            return EXIT_FAILURE;
+        }
+        pthread_join(thread, NULL);
+        if (!programs[idx].opened)
+            failed++;
+        else if (!print_trace)
+            printf("%s: %u lines, %llu blocks, %u errors, trace %016llx\n", programs[idx].name, programs[idx].lines,
+                    (unsigned long long)programs[idx].blocks, programs[idx].errors, (unsigned long long)programs[idx].checksum);
+        lines += programs[idx].lines;
+        fast_lines += programs[idx].fast_lines;
+    }
+
+    fprintf(stderr, "%u programs, %llu lines, %llu executed by the fast path\n", n_programs,
+             (unsigned long long)lines, (unsigned long long)fast_lines);
+
+    return failed ? 2 : EXIT_SUCCESS;
+}
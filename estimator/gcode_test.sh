@@ -0,0 +1,33 @@
+#!/bin/sh
+#
+# gcode_test.sh - builds gcode_test with and without the g-code parser fast path, checks the traces
+# of the programs in estimator/cases against their expected .trace files and compares the traces of
+# the two builds for the cases and the given programs and directories, see gcode_test.c.
+# Run from the repository root: estimator/gcode_test.sh [program.nc|directory...]
+#
+
+CFLAGS="-O2 -std=gnu11 -funsigned-char -pthread -DCORE_INSTANCE_PER_THREAD -Igrbl -Wl,--wrap=plan_buffer_line"
+
+gcc $CFLAGS -o build/gcode_test estimator/gcode_test.c grbl/[a-z]*.c -lm || exit 1
+gcc $CFLAGS -DGCODE_TEST_REFERENCE -o build/gcode_test_ref estimator/gcode_test.c $(ls grbl/[a-z]*.c | grep -v /gcode.c) -lm || exit 1
+
+# Cases with known results, the trace is printed with -t and the expected trace regenerated likewise.
+for case in estimator/cases/*.nc; do
+    build/gcode_test -t "$case" 2> /dev/null > build/gcode_test_case.txt || exit 1
+    if ! cmp -s build/gcode_test_case.txt "${case%.nc}.trace"; then
+        diff "${case%.nc}.trace" build/gcode_test_case.txt
+        echo "FAILED: $case does not match ${case%.nc}.trace"
+        exit 1
+    fi
+done
+
+build/gcode_test estimator/cases "$@" > build/gcode_test.txt || exit 1
+build/gcode_test_ref estimator/cases "$@" > build/gcode_test_ref.txt 2> /dev/null || exit 1
+
+if cmp -s build/gcode_test.txt build/gcode_test_ref.txt; then
+    echo "PASSED: $(wc -l < build/gcode_test.txt) programs, traces identical"
+else
+    diff build/gcode_test_ref.txt build/gcode_test.txt
+    echo "FAILED: rerun the programs that differ with gcode_test -t and gcode_test_ref -t to compare the traces"
+    exit 1
+fi
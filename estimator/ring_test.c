@@ -0,0 +1,393 @@
+/*
+  ring_test.c - stress test of the step segment buffer across two CPUs
+  Part of Grbl
+
+  Copyright (c) 2017 Terje Io
+
+  Grbl is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  Grbl is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with Grbl.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+/*
+  Runs the core's own planner, segment prep and stepper interrupt handler on two threads, pinned to
+  different CPUs. The producer thread plays the main program, it plans random moves with
+  plan_buffer_line() and refills the step segment buffer with st_prep_buffer(). The consumer thread
+  plays the step timer, it calls stepper_driver_interrupt_handler() back to back while the stepper is
+  awake. The segment buffer head and tail indices and the st_block_t data are thus shared across CPUs
+  exactly as on a target with segment prep and step output on different cores.
+
+  A segment or stepper block read before its index is observed, or overwritten before the stepper is
+  done with it, shows up as a step count or direction error. The step pulses output via the HAL and
+  sys_position are checked against the planned targets when the last move is done.
+
+  The planner block buffer is not shared, plan_buffer_line() and segment prep both run in the main
+  program, as they do on the targets.
+
+  Build on the host from the repository root:
+
+    gcc -O2 -std=gnu11 -funsigned-char -pthread -DUSE_C11_ATOMICS -Igrbl -o build/ring_test estimator/ring_test.c grbl/[a-z]*.c -lm
+
+  Usage: ring_test [-p producer cpu] [-c consumer cpu] [moves]
+
+    -p  CPU the producer is pinned to, defaults to 0.
+    -c  CPU the consumer is pinned to, defaults to 1. If it is the producer CPU the threads yield
+        while waiting, this only checks the test itself.
+
+  Moves defaults to 10000. The exit code is 0 if every step was output, 1 on a step count or position
+  error and 2 if the test could not be set up.
+
+  NOTE: x86 orders stores and loads strongly enough to pass with plain volatile indices as well, the
+  acquire/release ordering is exercised on weakly ordered CPUs such as ARM and POWER.
+*/
+
+#define _GNU_SOURCE
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <pthread.h>
+#include <sched.h>
+#include <unistd.h>
+#include <time.h>
+
+#include "grbl.h"
+
+#ifndef USE_C11_ATOMICS
+#error "The ring test must be built with USE_C11_ATOMICS defined."
+#endif
+
+#ifdef CORE_INSTANCE_PER_THREAD
+#error "The ring test shares one core instance between its threads, build without CORE_INSTANCE_PER_THREAD."
+#endif
+
+#define RING_TEST_RANGE 10.0f // Moves are random within +/- this many mm on each axis.
+
+typedef struct {
+    uint32_t moves;
+    bool yield;        // Yield while waiting, producer and consumer share a CPU
+    bool running;      // Step timer enabled, set and cleared by the stepper HAL functions
+    bool done;         // Set by the producer when the last move is complete
+    int32_t target[N_AXIS];   // Final target in steps, owned by the producer
+    uint64_t expected[N_AXIS]; // Planned steps per axis, owned by the producer
+    int32_t position[N_AXIS];  // Position from the output step pulses, owned by the consumer
+    uint64_t pulses[N_AXIS];   // Output step pulses per axis, owned by the consumer
+    uint64_t ticks;
+    uint64_t cycle_stops;
+} ring_test_t;
+
+static ring_test_t test;
+static uint32_t arena[16384];
+
+static void host_delay_milliseconds (uint32_t ms, void (*callback)(void))
+{
+    if(callback)
+        callback();
+}
+
+static void host_stepper_wake_up (void)
+{
+    __atomic_store_n(&test.running, true, __ATOMIC_RELEASE);
+}
+
+static void host_stepper_go_idle (void)
+{
+    __atomic_store_n(&test.running, false, __ATOMIC_RELEASE);
+}
+
+static void host_stepper_cycles_per_tick (uint32_t cycles_per_tick)
+{
+}
+
+static void host_stepper_enable (bool on)
+{
+}
+
+static void host_stepper_set_outputs (axes_signals_t step_outbits)
+{
+}
+
+// Counts the step pulses output by the stepper interrupt handler and tracks the position from them.
+static void host_stepper_pulse_start (axes_signals_t dir_outbits, axes_signals_t step_outbits, uint32_t spindle_pwm)
+{
+    uint_fast8_t idx = N_AXIS;
+
+    do {
+        idx--;
+        if(step_outbits.value & bit(idx)) {
+            test.pulses[idx]++;
+            test.position[idx] += (dir_outbits.value & bit(idx)) ? -1 : 1;
+        }
+    } while(idx);
+}
+
+static uint32_t host_spindle_set_speed (uint32_t pwm_value)
+{
+    return pwm_value;
+}
+
+static void host_serial_write (uint8_t c)
+{
+}
+
+static void host_serial_write_string (const char *s)
+{
+}
+
+static void host_set_bits_atomic (volatile uint8_t *value, uint8_t bits)
+{
+    __atomic_fetch_or(value, bits, __ATOMIC_SEQ_CST);
+}
+
+static uint8_t host_clear_bits_atomic (volatile uint8_t *value, uint8_t bits)
+{
+    return __atomic_fetch_and(value, (uint8_t)~bits, __ATOMIC_SEQ_CST);
+}
+
+static uint8_t host_set_value_atomic (volatile uint8_t *value, uint8_t bits)
+{
+    return __atomic_exchange_n(value, bits, __ATOMIC_SEQ_CST);
+}
+
+static void host_settings_changed (settings_t *settings)
+{
+}
+
+bool driver_init (void)
+{
+    hal.f_step_timer = 20000000;
+    hal.rx_buffer_size = 1024;
+    hal.arena = (uint8_t *)arena;
+    hal.arena_size = sizeof(arena);
+
+    hal.delay_milliseconds = host_delay_milliseconds;
+
+    hal.stepper_wake_up = host_stepper_wake_up;
+    hal.stepper_go_idle = host_stepper_go_idle;
+    hal.stepper_enable = host_stepper_enable;
+    hal.stepper_set_outputs = host_stepper_set_outputs;
+    hal.stepper_set_directions = host_stepper_set_outputs;
+    hal.stepper_cycles_per_tick = host_stepper_cycles_per_tick;
+    hal.stepper_pulse_start = host_stepper_pulse_start;
+    hal.spindle_set_speed = host_spindle_set_speed;
+
+    hal.serial_write = host_serial_write;
+    hal.serial_write_string = host_serial_write_string;
+
+    hal.set_bits_atomic = host_set_bits_atomic;
+    hal.clear_bits_atomic = host_clear_bits_atomic;
+    hal.set_value_atomic = host_set_value_atomic;
+
+    hal.settings_changed = host_settings_changed;
+
+    hal.eeprom.type = EEPROM_None;
+
+    hal.driver_cap.amass_level = MAX_AMASS_LEVEL;
+
+    return true;
+}
+
+// Refills the segment buffer and restarts the stepper after it has run dry, as the realtime protocol
+// does on cycle stop followed by an auto cycle start.
+static void ring_service (bool *idle)
+{
+    st_prep_buffer();
+
+    if(system_clear_exec_state_flag(EXEC_CYCLE_STOP) & EXEC_CYCLE_STOP) {
+        test.cycle_stops++;
+        *idle = true;
+    }
+
+    if(*idle) {
+        *idle = false;
+        st_wake_up();
+    } else if(test.yield)
+        sched_yield();
+}
+
+// Plans random moves and keeps the segment buffer filled, as the main program does.
+static void *producer (void *arg)
+{
+    bool idle = true, woken;
+    float target[N_AXIS];
+    uint32_t move;
+    uint_fast8_t idx;
+    plan_line_data_t plan_data;
+
+    memset(&plan_data, 0, sizeof(plan_line_data_t));
+
+    for(move = 0; move < test.moves; move++) {
+
+        plan_data.feed_rate = 100.0f + (float)(rand() % 900);
+        plan_data.condition.rapid_motion = (rand() & 0x07) == 0;
+
+        for(idx = 0; idx < N_AXIS; idx++) {
+            target[idx] = RING_TEST_RANGE * ((float)(rand() % 2001) - 1000.0f) / 1000.0f;
+            int32_t target_steps = lroundf(target[idx] * settings.steps_per_mm[idx]);
+            test.expected[idx] += labs(target_steps - test.target[idx]);
+            test.target[idx] = target_steps;
+        }
+
+        while(plan_check_full_buffer())
+            ring_service(&idle);
+
+        plan_buffer_line(target, &plan_data);
+
+        ring_service(&idle);
+    }
+
+    // Segment prep discards a planner block after its last segment is published, when the planner
+    // is empty the remaining steps are all in the segment buffer.
+    while(plan_get_current_block())
+        ring_service(&idle);
+
+    // The stepper may have stopped on a stale head index, so the run is only complete on a cycle stop
+    // following a restart issued from here.
+    for(woken = false; !(idle && woken); ) {
+        st_prep_buffer();
+        if(system_clear_exec_state_flag(EXEC_CYCLE_STOP) & EXEC_CYCLE_STOP) {
+            if(!(idle = woken)) {
+                st_wake_up();
+                woken = true;
+            }
+        } else if(test.yield)
+            sched_yield();
+    }
+
+    __atomic_store_n(&test.done, true, __ATOMIC_RELEASE);
+
+    return NULL;
+}
+
+// Runs the stepper interrupt handler back to back while the step timer is enabled.
+static void *consumer (void *arg)
+{
+    while(!__atomic_load_n(&test.done, __ATOMIC_ACQUIRE)) {
+        if(__atomic_load_n(&test.running, __ATOMIC_ACQUIRE)) {
+            stepper_driver_interrupt_handler();
+            test.ticks++;
+        } else if(test.yield)
+            sched_yield();
+    }
+
+    return NULL;
+}
+
+static void usage (void)
+{
+    fputs("Usage: ring_test [-p producer cpu] [-c consumer cpu] [moves]\n", stderr);
+}
+
+// Starts a thread pinned to a CPU.
+static bool start_pinned (pthread_t *thread, void *(*handler)(void *), int cpu)
+{
+    bool ok;
+    cpu_set_t cpuset;
+    pthread_attr_t attr;
+
+    CPU_ZERO(&cpuset);
+    CPU_SET(cpu, &cpuset);
+
+    pthread_attr_init(&attr);
+    ok = pthread_attr_setaffinity_np(&attr, sizeof(cpu_set_t), &cpuset) == 0 &&
+          pthread_create(thread, &attr, handler, NULL) == 0;
+    pthread_attr_destroy(&attr);
+
+    return ok;
+}
+
+int main (int argc, char **argv)
+{
+    int opt, producer_cpu = 0, consumer_cpu = 1;
+    bool ok = true;
+    uint_fast8_t idx;
+    pthread_t producer_thread, consumer_thread;
+    struct timespec start, end;
+
+    test.moves = 10000;
+
+    while((opt = getopt(argc, argv, "p:c:")) != -1) switch(opt) {
+
+        case 'p':
+            producer_cpu = atoi(optarg);
+            break;
+
+        case 'c':
+            consumer_cpu = atoi(optarg);
+            break;
+
+        default:
+            usage();
+            return 2;
+    }
+
+    if(optind < argc)
+        test.moves = (uint32_t)strtoul(argv[optind], NULL, 10);
+
+    if(test.moves == 0) {
+        usage();
+        return 2;
+    }
+
+    test.yield = producer_cpu == consumer_cpu;
+
+    // Bring up the parts of the core involved, as grbl_enter() does.
+    memset(&hal, 0, sizeof(HAL));
+    hal.version = 5;
+    driver_init();
+    settings_init();
+
+    if(!arena_init()) {
+        fputs("ring_test: insufficient memory for buffers\n", stderr);
+        return 2;
+    }
+
+    plan_reset();
+    st_reset();
+    plan_sync_position();
+
+    clock_gettime(CLOCK_MONOTONIC, &start);
+
+    if(!start_pinned(&consumer_thread, consumer, consumer_cpu)) {
+        fprintf(stderr, "ring_test: cannot start the consumer on CPU %d\n", consumer_cpu);
+        return 2;
+    }
+
+    if(!start_pinned(&producer_thread, producer, producer_cpu)) {
+        fprintf(stderr, "ring_test: cannot start the producer on CPU %d\n", producer_cpu);
+        return 2;
+    }
+
+    pthread_join(producer_thread, NULL);
+    pthread_join(consumer_thread, NULL);
+
+    clock_gettime(CLOCK_MONOTONIC, &end);
+
+    double seconds = (double)(end.tv_sec - start.tv_sec) + (double)(end.tv_nsec - start.tv_nsec) / 1e9;
+
+    printf("Buffers:   %u planner blocks, %u segments, CPU %d to CPU %d\n", settings.planner_buffer_blocks,
+            settings.segment_buffer_size, producer_cpu, consumer_cpu);
+    printf("Moves:     %u in %.2f s, %llu ticks, %llu cycle stops\n", test.moves, seconds,
+            (unsigned long long)test.ticks, (unsigned long long)test.cycle_stops);
+
+    for(idx = 0; idx < N_AXIS; idx++) {
+        bool axis_ok = test.pulses[idx] == test.expected[idx] && test.position[idx] == test.target[idx] &&
+                        sys_position[idx] == test.target[idx];
+        printf("Axis %d:    %llu of %llu steps, at %ld (%ld) of %ld%s\n", (int)idx, (unsigned long long)test.pulses[idx],
+                (unsigned long long)test.expected[idx], (long)test.position[idx], (long)sys_position[idx],
+                 (long)test.target[idx], axis_ok ? "" : " FAILED");
+        ok = ok && axis_ok;
+    }
+
+    puts(ok ? "PASSED" : "FAILED");
+
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,113 @@
+/*
+  arena.c - startup memory arena for the runtime sized buffers
+  Part of Grbl
+
+  Copyright (c) 2017 Terje Io
+
+  Grbl is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  Grbl is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with Grbl.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+/*
+  The planner block buffer, the step segment buffers, the protocol line buffers, the parse queue and the job
+  read-ahead buffer are carved out of a single block of RAM, the arena. The rest of the arena is the program store for O-word subroutines and loops.
+  Buffer sizes are settings so one firmware image may use the look-ahead each board can afford. The driver may
+  provide the arena (hal.arena, hal.arena_size), typically all RAM not used otherwise, if not an internal block
+  of ARENA_SIZE bytes is used.
+  NOTE: Buffers are carved on each reset, size changes thus takes effect after a soft-reset.
+*/
+
+#include "grbl.h"
+
+// Round up to keep each buffer 32-bit aligned.
+#define ARENA_ALIGN(size) (((size) + 3) & ~3)
+
+static CORE_STATE uint32_t arena_default[ARENA_SIZE / sizeof(uint32_t)];
+
+inline static uint8_t *arena_base (void)
+{
+    return hal.arena ? hal.arena : (uint8_t *)arena_default;
+}
+
+inline static uint32_t arena_size (void)
+{
+    return hal.arena ? hal.arena_size : sizeof(arena_default);
+}
+
+static uint32_t arena_required (uint32_t planner_blocks, uint32_t segments, uint32_t line_size, uint32_t queue_lines)
+{
+    return ARENA_ALIGN(plan_buffer_size(planner_blocks)) +
+            ARENA_ALIGN(st_buffer_size(segments)) +
+             ARENA_ALIGN(protocol_buffer_size(line_size)) +
+              ARENA_ALIGN(mc_queue_size(queue_lines)) +
+               ARENA_ALIGN(job_buffer_size());
+}
+
+// Returns true if buffers of the given sizes fits in the arena.
+bool arena_buffers_fit (uint32_t planner_blocks, uint32_t segments, uint32_t line_size, uint32_t queue_lines)
+{
+    return arena_required(planner_blocks, segments, line_size, queue_lines) <= arena_size();
+}
+
+// Carves the runtime sized buffers from the arena. Falls back to the compile-time default
+// sizes if the configured sizes do not fit, this may happen if the driver provides less RAM
+// than the settings were validated against. The default sizes are then stored so the
+// fallback is reported only once.
+bool arena_init (void)
+{
+    uint32_t planner_blocks = settings.planner_buffer_blocks,
+             segments = settings.segment_buffer_size,
+             line_size = settings.line_buffer_size,
+             queue_lines = settings.parse_queue_size;
+
+    if (!arena_buffers_fit(planner_blocks, segments, line_size, queue_lines)) {
+
+        planner_blocks = BLOCK_BUFFER_SIZE;
+        segments = SEGMENT_BUFFER_SIZE;
+        line_size = LINE_BUFFER_SIZE;
+        queue_lines = PARSE_QUEUE_SIZE;
+
+        if (!arena_buffers_fit(planner_blocks, segments, line_size, queue_lines))
+            return false;
+
+        settings.planner_buffer_blocks = planner_blocks;
+        settings.segment_buffer_size = segments;
+        settings.line_buffer_size = line_size;
+        settings.parse_queue_size = queue_lines;
+        write_global_settings();
+
+        report_feedback_message(Message_BufferSizesRestored);
+    }
+
+    uint8_t *mem = arena_base();
+
+    plan_buffer_init(mem, planner_blocks);
+    mem += ARENA_ALIGN(plan_buffer_size(planner_blocks));
+
+    st_buffer_init(mem, segments);
+    mem += ARENA_ALIGN(st_buffer_size(segments));
+
+    protocol_buffer_init((char *)mem, line_size);
+    mem += ARENA_ALIGN(protocol_buffer_size(line_size));
+
+    mc_queue_init(mem, queue_lines);
+    mem += ARENA_ALIGN(mc_queue_size(queue_lines));
+
+    job_buffer_init(mem, job_buffer_size());
+    mem += ARENA_ALIGN(job_buffer_size());
+
+    // The rest of the arena is the program store for O-word subroutines and loops.
+    ngc_flowctrl_init((char *)mem, arena_base() + arena_size() - mem);
+
+    return true;
+}
@@ -0,0 +1,32 @@
+/*
+  arena.h - startup memory arena for the runtime sized buffers
+  Part of Grbl
+
+  Copyright (c) 2017 Terje Io
+
+  Grbl is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  Grbl is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with Grbl.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef arena_h
+#define arena_h
+
+// Carves the planner, step segment, line and parse queue buffers from the arena, sized from settings.
+// Called on startup and on each reset before plan_reset() and st_reset().
+// Returns false if not even the compile-time default sizes fits.
+bool arena_init (void);
+
+// Returns true if buffers of the given sizes fits in the arena.
+bool arena_buffers_fit (uint32_t planner_blocks, uint32_t segments, uint32_t line_size, uint32_t queue_lines);
+
+#endif
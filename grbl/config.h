@@ -60,6 +60,7 @@
 // space, protocol.c's protocol_process_realtime() will need to be modified to accomodate the change.
 #define CMD_SAFETY_DOOR 0x84
 #define CMD_JOG_CANCEL  0x85
+#define CMD_STATUS_REPORT_BINARY 0x87 // Requests a binary status frame, see report_realtime_status_binary().
 //#define CMD_DEBUG_REPORT 0x86 // Only when DEBUG enabled, sends debug report in '{}' braces.
 #define CMD_FEED_OVR_RESET 0x90         // Restores feed override value to 100%.
 #define CMD_FEED_OVR_COARSE_PLUS 0x91
@@ -160,6 +161,27 @@
 // goes from 16 to 15 to make room for the additional line number data in the plan_block_t struct
 // #define USE_LINE_NUMBERS // Disabled by default. Uncomment to enable.
 
+// Executes blocks with only axis words and optionally F and N words in an unchanged G0 or G1 state,
+// the bulk of CAM output, without the full modal group and word validation of the g-code parser.
+// The result is identical to the full parser, any other block falls through to it. estimator/gcode_test.sh
+// checks this for a set of programs.
+#define GCODE_FAST_PATH // Default enabled. Comment to disable.
+
+// Accepts binary g-code blocks, lines starting with '&', a compact encoding of blocks with plain
+// words that is decoded without the character scanner. See gcode_binary.c for the format and
+// doc/script/gcode2bin.py for the converter.
+#define GCODE_BINARY_BLOCKS // Default enabled. Comment to disable.
+
+// Accepts an E word with G0-G3 motions, the exit speed of the block computed by the host over the whole
+// program, see doc/script/lookahead.py. The planner uses it in place of a stop at the end of the buffer.
+// WARNING: A hint is only limited by the nominal speed of the block, not verified against the motions
+// that follow, which the controller does not hold yet. If the stream stalls, or a feed hold is issued
+// near the end of the buffer, the last block ends at a speed the machine can not stop from within its
+// acceleration limits and steps may be lost. A hint too high for the next block makes the planner replan,
+// but segments already prepared are not slowed down. Only enable for machines that tolerate this, with
+// jobs streamed from a host or storage that keeps the buffer filled.
+// #define PLANNER_EXIT_SPEED_HINTS // Default disabled. Uncomment to enable.
+
 // Upon a successful probe cycle, this option provides immediately feedback of the probe coordinates
 // through an automatically generated message. If disabled, users can still access the last probe
 // coordinates through Grbl '$#' print parameters.
@@ -281,6 +303,20 @@
 #define REPORT_WCO_REFRESH_BUSY_COUNT 30  // (2-255)
 #define REPORT_WCO_REFRESH_IDLE_COUNT 10  // (2-255) Must be less than or equal to the busy count
 
+// Status reports may be pushed by Grbl without a '?' request, enabled by setting $60 to the report
+// interval in milliseconds. Auto reports are sent at this interval while in motion (cycle, jog,
+// homing, hold and safety door states) and on each state change. Interval reports only include the
+// WCO, Ov, A and Pn fields when their values has changed since last reported, state change reports
+// follow the refresh counts above. Requires the driver to provide a millisecond tick counter.
+#define MIN_STATUS_REPORT_INTERVAL 10 // (1-1000) msec, lowest accepted $60 value.
+
+// Acknowledgements for consecutive successful lines may be coalesced into a single ok:N response,
+// enabled by setting $61 to the max number of lines to acknowledge per response. Pending
+// acknowledgements are sent when the count is reached, when the planner buffer is full or synced,
+// before any other response or message, and when no more input is available. The latter is delayed
+// by this timeout, if the driver provides a millisecond tick counter, to catch lines arriving in bursts.
+#define ACK_COALESCE_TIMEOUT 2 // (0-255) msec
+
 // The temporal resolution of the acceleration management subsystem. A higher number gives smoother
 // acceleration, particularly noticeable on machines that run at very high feedrates, but may negatively
 // impact performance. The correct value for this parameter is machine dependent, so it's advised to
@@ -290,6 +326,27 @@
 // certain the step segment buffer is increased/decreased to account for these changes.
 #define ACCELERATION_TICKS_PER_SECOND 100
 
+// Enables variable step segment execution time. Segments prepared while cruising at constant speed
+// are extended to CRUISE_SEGMENT_TIME_MULTIPLIER times the acceleration tick time, while segments in
+// acceleration and deceleration ramps keep the time set by ACCELERATION_TICKS_PER_SECOND. Extended
+// segments are cut at the end of the cruise so ramps are traced with full resolution. This lets the
+// step segment buffer hold more time of motion and reduces the number of segment prep passes during
+// long straight moves.
+// NOTE: Feed holds and overrides can only act on segments not yet in the segment buffer, so enabling
+// this adds up to (SEGMENT_BUFFER_SIZE-1) extended segment times to their response when cruising.
+// #define ADAPTIVE_SEGMENT_TIME // Default disabled. Uncomment to enable.
+#define CRUISE_SEGMENT_TIME_MULTIPLIER 4 // (2-10) Cruise segment time in acceleration ticks.
+
+// Enables segment prep from a low priority interrupt. The stepper ISR requests a segment buffer refill
+// via hal.stepper_prep_request() when fewer than SEGMENT_PREP_WATERMARK segments are left, so motion
+// no longer depends on the main loop getting around to it during long parser, report, arc generation
+// or EEPROM write operations. The main loop still polls st_prep_buffer() as before.
+// NOTE: Requires driver support, the request must pend an interrupt (e.g. PendSV on Cortex-M) running
+// at lower priority than the stepper, limit, control and serial interrupts that calls
+// hal.stepper_prep_callback(). Ignored if the driver does not provide hal.stepper_prep_request.
+// #define STEPPER_PREP_INTERRUPT // Default disabled. Uncomment to enable.
+#define SEGMENT_PREP_WATERMARK 3 // (1-255) Limited to the segment buffer size - 1 at run time.
+
 // Adaptive Multi-Axis Step Smoothing (AMASS) is an advanced feature that does what its name implies,
 // smoothing the stepping of multi-axis motions. This feature smooths motion particularly at low step
 // frequencies below 10kHz, where the aliasing between axes of multi-axis motions can cause audible
@@ -304,12 +361,14 @@
 // timer, and the CPU overhead. Level 0 (no AMASS, normal operation) frequency bin starts at the
 // Level 1 cutoff frequency and up to as fast as the CPU allows (over 30kHz in limited testing).
 // NOTE: AMASS cutoff frequency multiplied by ISR overdrive factor must not exceed maximum step frequency.
-// NOTE: Current settings are set to overdrive the ISR to no more than 16kHz, balancing CPU overhead
-// and timer accuracy.  Do not alter these settings unless you know what you are doing.
+// NOTE: The number of active levels and their cutoff frequencies are runtime settings ($37 and $40-$45),
+// MAX_AMASS_LEVEL only sets the highest level that may be selected. The active level count is further
+// limited by the driver capability (hal.driver_cap.amass_level). Default settings overdrive the ISR to
+// no more than 16kHz, balancing CPU overhead and timer accuracy.
 #ifdef ADAPTIVE_MULTI_AXIS_STEP_SMOOTHING
-  #define MAX_AMASS_LEVEL 3
-  #if MAX_AMASS_LEVEL <= 0
-    error "AMASS must have 1 or more levels to operate correctly."
+  #define MAX_AMASS_LEVEL 6
+  #if MAX_AMASS_LEVEL <= 0 || MAX_AMASS_LEVEL > 6
+    error "AMASS must have 1 to 6 levels to operate correctly."
   #endif
 #endif
 
@@ -415,6 +474,11 @@
 // much greater than this. The default setting should capture most, if not all, full arc error situations.
 #define ARC_ANGULAR_TRAVEL_EPSILON 5E-7 // Float (radians)
 
+// Clearance used by the G73 and G83 peck drilling cycles. G73 retracts this distance after each peck
+// to break the chip, G83 rapids back down to this distance above the previous peck depth after each
+// full retract to the R plane. The default is 0.010 inch.
+#define CANNED_CYCLE_PECK_CLEARANCE 0.254f // Float (mm)
+
 // Time delay increments performed during a dwell. The default value is set at 50ms, which provides
 // a maximum time delay of roughly 55 minutes, more than enough for most any application. Increasing
 // this delay will increase the maximum dwell time linearly, but also reduces the responsiveness of
@@ -458,6 +522,38 @@
 // we know how much extra memory space we can re-invest into this.
 // #define LINE_BUFFER_SIZE 80  // Uncomment to override default (256) in protocol.h
 
+// Number of parsed lines that may be staged between the g-code parser and the planner when the
+// planner buffer is full. The parser then keeps consuming input, so errors are reported early and
+// parsing is done ahead of the planner. Set to 0 to disable.
+// #define PARSE_QUEUE_SIZE 16 // Uncomment to override default in motion_control.h.
+
+// NOTE: The four buffer sizes above are the defaults for settings $50, $51, $52 and $53. The buffers
+// are carved from a RAM block, the arena, on startup and reset. If the driver does not provide
+// the arena (hal.arena) an internal block of ARENA_SIZE bytes is used, it must be large enough
+// to hold the buffers with their default sizes. The rest of the arena is the program store for
+// O-word subroutines and loops.
+#define ARENA_SIZE 5120 // bytes
+
+// Size of the read-ahead buffer for jobs run from storage with $FR. It is carved from the arena
+// if the driver provides file storage (hal.file).
+// #define JOB_READ_AHEAD_SIZE 512 // Uncomment to override default in job.h.
+
+// Enables C11 atomics with acquire/release ordering for the head and tail indices of the planner
+// block buffer and the step segment buffer. Needed when the producer and consumer of these buffers
+// runs on different CPU cores, e.g. segment prep on one core and step output on another, or in a
+// host build with threads. On single core targets the default volatile indices are sufficient.
+// NOTE: Requires a C11 compiler with <stdatomic.h>. estimator/ring_test.c stress tests the ordering of the
+//       step segment buffer with the core planner, segment prep and stepper interrupt handler.
+// #define USE_C11_ATOMICS // Default disabled. Uncomment to enable.
+
+// Makes the core state, the system, parser, planner, stepper and protocol state, the settings and
+// the HAL struct, thread-local. Each thread then runs an independent controller instance, created by
+// calling grbl_enter() from the thread, so that a host build may simulate many machines concurrently.
+// NOTE: For host builds only. All HAL callbacks of an instance, including the stepper interrupt
+// handler and realtime commands, must be called from the thread that owns it. The driver must keep
+// its own state thread-local as well, CORE_STATE may be used for that.
+// #define CORE_INSTANCE_PER_THREAD // Default disabled. Uncomment to enable.
+
 // Serial send and receive buffer size. The receive buffer is often used as another streaming
 // buffer to store incoming blocks to be processed by Grbl when its ready. Most streaming
 // interfaces will character count and track each block send to each block response. So,
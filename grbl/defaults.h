@@ -71,6 +71,15 @@
   #define DEFAULT_HOMING_SEEK_RATE 500.0 // mm/min
   #define DEFAULT_HOMING_DEBOUNCE_DELAY 250 // msec (0-65k)
   #define DEFAULT_HOMING_PULLOFF 1.0 // mm
+  #define DEFAULT_AMASS_LEVELS 3
+  #define DEFAULT_AMASS_CUTOFF_1 8000 // Hz
+  #define DEFAULT_AMASS_CUTOFF_2 4000 // Hz
+  #define DEFAULT_AMASS_CUTOFF_3 2000 // Hz
+  #define DEFAULT_AMASS_CUTOFF_4 1000 // Hz
+  #define DEFAULT_AMASS_CUTOFF_5 500 // Hz
+  #define DEFAULT_AMASS_CUTOFF_6 250 // Hz
+  #define DEFAULT_STATUS_REPORT_INTERVAL 0 // msec (0-65k), 0 disables auto reports
+  #define DEFAULT_ACK_COALESCE_LINES 0 // (0-255) lines, 0 disables acknowledgement coalescing
 
  #define DEFAULT_A_STEPS_PER_MM 250.0
  #define DEFAULT_A_MAX_RATE 500.0 // mm/min
@@ -27,10 +27,10 @@
 
 #include "grbl.h"
 
-static uint8_t *noepromdata = 0;
-static eeprom_io_t physical_eeprom;
+static CORE_STATE uint8_t *noepromdata = 0;
+static CORE_STATE eeprom_io_t physical_eeprom;
 
-settings_dirty_t settings_dirty;
+CORE_STATE settings_dirty_t settings_dirty;
 
 static inline uint8_t ram_get_byte (uint32_t addr)
 {
@@ -32,7 +32,7 @@ typedef struct {
     bool coord_data[N_COORDINATE_SYSTEM];
 } settings_dirty_t;
 
-extern settings_dirty_t settings_dirty;
+extern CORE_STATE settings_dirty_t settings_dirty;
 
 bool eeprom_emu_init();
 void eeprom_emu_sync_physical ();
@@ -35,8 +35,8 @@ typedef enum {
 } axis_command_t;
 
 // Declare gc extern struct
-parser_state_t gc_state;
-parser_block_t gc_block;
+CORE_STATE parser_state_t gc_state;
+CORE_STATE parser_block_t gc_block;
 
 #define FAIL(status) return(status);
 
@@ -52,6 +52,10 @@ void gc_init()
     // Load default G54 coordinate system.
     if (!(settings_read_coord_data(gc_state.modal.coord_select, gc_state.coord_system)))
         report_status_message(Status_SettingReadFail);
+
+  #ifdef GCODE_BINARY_BLOCKS
+    gc_binary_reset();
+  #endif
 }
 
 
@@ -72,6 +76,147 @@ void gc_set_laser_ppimode (bool on)
 }
 
 
+#ifdef GCODE_FAST_PATH
+
+// Fast path for blocks with only axis words and optionally F and N words in an unchanged G0/G1,
+// G94 modal state. Executes the block exactly as gc_execute_line() would and returns true, or
+// returns false without side effects for any other block, which is then left to the full parser.
+// NOTE: Repeated words, negative values and undefined feed rates are also left to the full parser
+// to report.
+static bool gc_execute_fast_line (char *line)
+{
+    if (!(gc_state.modal.motion == MotionMode_Seek || gc_state.modal.motion == MotionMode_Linear) ||
+          gc_state.modal.feed_mode != FeedMode_UnitsPerMin || settings.flags.laser_mode)
+        return false;
+
+    char letter;
+    float value, target[N_AXIS], feed_rate = gc_state.feed_rate;
+  #ifdef PLANNER_EXIT_SPEED_HINTS
+    float exit_speed = 0.0f;
+  #endif
+    int32_t line_number = 0;
+    uint32_t char_counter = 0, idx;
+    uint32_t value_words = 0;
+    uint8_t axis_words = 0;
+
+    while ((letter = line[char_counter++]) != '\0') {
+
+        if (!read_float(line, &char_counter, &value))
+            return false;
+
+        switch(letter) {
+
+            case 'X':
+                idx = X_AXIS;
+                break;
+
+            case 'Y':
+                idx = Y_AXIS;
+                break;
+
+            case 'Z':
+                idx = Z_AXIS;
+                break;
+
+          #ifdef A_AXIS
+            case 'A':
+                idx = A_AXIS;
+                break;
+          #endif
+
+          #ifdef B_AXIS
+            case 'B':
+                idx = B_AXIS;
+                break;
+          #endif
+
+          #ifdef C_AXIS
+            case 'C':
+                idx = C_AXIS;
+                break;
+          #endif
+
+            case 'F':
+                if (bit_istrue(value_words, bit(Word_F)) || value < 0.0f)
+                    return false;
+                feed_rate = gc_state.modal.units == UnitsMode_Inches ? value * MM_PER_INCH : value;
+                value_words |= bit(Word_F);
+                continue;
+
+          #ifdef PLANNER_EXIT_SPEED_HINTS
+            case 'E':
+                if (bit_istrue(value_words, bit(Word_E)) || value < 0.0f)
+                    return false;
+                exit_speed = gc_state.modal.units == UnitsMode_Inches ? value * MM_PER_INCH : value;
+                value_words |= bit(Word_E);
+                continue;
+          #endif
+
+            case 'N':
+                if (bit_istrue(value_words, bit(Word_N)) || value < 0.0f || (line_number = (int32_t)truncf(value)) > MAX_LINE_NUMBER)
+                    return false;
+                value_words |= bit(Word_N);
+                continue;
+
+            default:
+                return false;
+        }
+
+        if (bit_istrue(axis_words, bit(idx)))
+            return false;
+
+        target[idx] = value;
+        axis_words |= bit(idx);
+    }
+
+    if (!axis_words || (gc_state.modal.motion == MotionMode_Linear && feed_rate == 0.0f))
+        return false;
+
+    // Compute target position as the full parser does, the order of operations must be kept for identical results.
+    idx = N_AXIS;
+    do {
+        if (bit_isfalse(axis_words, bit(--idx)))
+            target[idx] = gc_state.position[idx];
+        else {
+            if (gc_state.modal.units == UnitsMode_Inches)
+                target[idx] *= MM_PER_INCH;
+            if (gc_state.modal.distance == DistanceMode_Absolute) {
+                target[idx] += gc_state.coord_system[idx] + gc_state.coord_offset[idx];
+                if (idx == TOOL_LENGTH_OFFSET_AXIS)
+                    target[idx] += gc_state.tool_length_offset;
+            } else
+                target[idx] += gc_state.position[idx];
+        }
+    } while(idx);
+
+    plan_line_data_t plan_data;
+    memset(&plan_data, 0, sizeof(plan_line_data_t));
+
+    gc_state.line_number = line_number;
+  #ifdef USE_LINE_NUMBERS
+    plan_data.line_number = line_number;
+  #endif
+    gc_state.feed_rate = plan_data.feed_rate = feed_rate;
+  #ifdef PLANNER_EXIT_SPEED_HINTS
+    plan_data.exit_speed = exit_speed;
+  #endif
+    gc_state.tool = 0; // The full parser sets the tool number from the T word, zero if absent.
+
+    plan_data.spindle_speed = gc_state.spindle_speed;
+    plan_data.condition.spindle = gc_state.modal.spindle;
+    plan_data.condition.is_pwm_rate_adjusted = gc_state.is_pwm_rate_adjusted;
+    plan_data.condition.coolant = gc_state.modal.coolant;
+    plan_data.condition.rapid_motion = gc_state.modal.motion == MotionMode_Seek;
+
+    mc_line(target, &plan_data);
+
+    memcpy(gc_state.position, target, sizeof(target));
+
+    return true;
+}
+
+#endif
+
 // Executes one line of 0-terminated G-Code. The line is assumed to contain only uppercase
 // characters and signed floating point values (no whitespace). Comments and block delete
 // characters have been removed. In this function, all units and positions are converted and
@@ -86,6 +231,13 @@ status_code_t gc_execute_line(char *line)
      values struct, word tracking variables, and a non-modal commands tracker for the new
      block. This struct contains all of the necessary information to execute the block. */
 
+  #ifdef GCODE_FAST_PATH
+    if (line[0] != '$' && gc_execute_fast_line(line))
+        return Status_OK;
+  #endif
+
+    ngc_params_discard(); // Clear parameter assignments of a previous failed block.
+
     memset(&gc_block, 0, sizeof(parser_block_t)); // Initialize the parser block struct.
     memcpy(&gc_block.modal, &gc_state.modal, sizeof(gc_modal_t)); // Copy current modes
 
@@ -99,7 +251,7 @@ status_code_t gc_execute_line(char *line)
 
     // Initialize command and value words and parser flags variables.
     uint16_t command_words = 0; // Tracks G and M command words. Also used for modal group violations.
-    uint16_t value_words = 0; // Tracks value words.
+    uint32_t value_words = 0; // Tracks value words.
     gc_parser_flags_t gc_parser_flags = {0};
 
     // Determine if the line is a jogging motion or a normal g-code block.
@@ -125,19 +277,38 @@ status_code_t gc_execute_line(char *line)
     float value;
     uint8_t int_value = 0;
     uint16_t mantissa = 0;
+    uint_fast8_t binary_words = 0;
+    gc_binary_word_t *binary_word = NULL;
 
-    while (line[char_counter] != 0) { // Loop until no more g-code words in line.
+  #ifdef GCODE_BINARY_BLOCKS
+    // Binary blocks are decoded to words up front, bypassing the character scanner.
+    if (line[0] == GC_BINARY_BLOCK_PREFIX && (int_value = (uint8_t)gc_binary_decode(line, &binary_word, &binary_words)) != Status_OK)
+        FAIL((status_code_t)int_value);
+  #endif
 
-        // Import the next g-code word, expecting a letter followed by a value. Otherwise, error out.
-        letter = line[char_counter];
+    while (binary_word ? binary_words-- > 0 : line[char_counter] != 0) { // Loop until no more g-code words in line.
 
-        if((letter < 'A') || (letter > 'Z'))
-            FAIL(Status_ExpectedCommandLetter); // [Expected word letter]
+        if (binary_word) { // Next word of binary block.
+            letter = binary_word->letter;
+            value = binary_word++->value;
+        } else {
 
-        char_counter++;
+            // Import the next g-code word, expecting a letter followed by a value. Otherwise, error out.
+            letter = line[char_counter++];
 
-        if (!read_float(line, &char_counter, &value))
-            FAIL(Status_BadNumberFormat); // [Expected word value]
+            if (letter == '#') { // Parameter assignment, performed when the block is executed.
+                if ((int_value = (uint8_t)ngc_param_assign(line, &char_counter)) != Status_OK)
+                    FAIL((status_code_t)int_value);
+                continue;
+            }
+
+            if((letter < 'A') || (letter > 'Z'))
+                FAIL(Status_ExpectedCommandLetter); // [Expected word letter]
+
+            // Read word value, if not a number it may be a parameter reference or an expression.
+            if (!read_float(line, &char_counter, &value) && (int_value = (uint8_t)ngc_read_real_value(line, &char_counter, &value)) != Status_OK)
+                FAIL((status_code_t)int_value); // [Expected word value]
+        }
 
         // Convert values to smaller uint8 significand and mantissa values for parsing this word.
         // NOTE: Mantissa is multiplied by 100 to catch non-integer command values. This is more
@@ -182,8 +353,8 @@ status_code_t gc_execute_line(char *line)
                         }
                         break;
 
-                    case 0: case 1: case 2: case 3: case 38:
-                        // Check for G0/1/2/3/38 being called with G10/28/30/92 on same block.
+                    case 0: case 1: case 2: case 3: case 38: case 73: case 81: case 82: case 83:
+                        // Check for G0/1/2/3/38/73/81-83 being called with G10/28/30/92 on same block.
                         // * G43.1 is also an axis command but is not explicitly defined this way.
                         if (axis_command)
                             FAIL(Status_GcodeAxisCommandConflict);// [Axis word/command conflict]
@@ -219,6 +390,11 @@ status_code_t gc_execute_line(char *line)
                         }
                         break;
 
+                    case 98: case 99:
+                        word_bit.group = ModalGroup_G10;
+                        gc_block.modal.retract_mode = (cc_retract_mode_t)(int_value - 98);
+                        break;
+
                     case 93: case 94:
                         word_bit.group = ModalGroup_G5;
                         gc_block.modal.feed_mode = (feed_mode_t)(94 - int_value);
@@ -399,6 +575,13 @@ status_code_t gc_execute_line(char *line)
 
                     // case 'D': // Not supported
 
+                  #ifdef PLANNER_EXIT_SPEED_HINTS
+                    case 'E':
+                        word_bit.parameter = Word_E;
+                        gc_block.values.e = value;
+                        break;
+                  #endif
+
                     case 'F':
                         word_bit.parameter = Word_F;
                         gc_block.values.f = value;
@@ -439,7 +622,7 @@ status_code_t gc_execute_line(char *line)
                         gc_block.values.p = value;
                         break;
 
-                    case 'Q': // may be used for user defined mcodes
+                    case 'Q': // may be used for user defined mcodes or canned cycles
                         word_bit.parameter = Word_Q;
                         gc_block.values.q = value;
                         break;
@@ -487,9 +670,9 @@ status_code_t gc_execute_line(char *line)
                 if (bit_istrue(value_words, bit(word_bit.parameter)))
                     FAIL(Status_GcodeWordRepeated); // [Word repeated]
 
-                // Check for invalid negative values for words F, N, P, T, and S.
+                // Check for invalid negative values for words E, F, N, P, T, and S.
                 // NOTE: Negative value check is done here simply for code-efficiency.
-                if (bit(word_bit.parameter) & (bit(Word_F)|bit(Word_N)|bit(Word_P)|bit(Word_T)|bit(Word_S)) && value < 0.0f)
+                if (bit(word_bit.parameter) & (bit(Word_E)|bit(Word_F)|bit(Word_N)|bit(Word_P)|bit(Word_T)|bit(Word_S)) && value < 0.0f)
                     FAIL(Status_NegativeValue); // [Word value cannot be negative]
 
                 value_words |= bit(word_bit.parameter); // Flag to indicate parameter assigned.
@@ -647,6 +830,11 @@ status_code_t gc_execute_line(char *line)
             gc_block.values.xyz[idx] *= MM_PER_INCH;
     } while(idx);
 
+    // Keep the block canned cycle XYZ words, the depth and hole increments are not target positions.
+    float cc_words[N_AXIS];
+    if (is_canned_cycle(gc_block.modal.motion))
+        memcpy(cc_words, gc_block.values.xyz, sizeof(cc_words));
+
     // [13. Cutter radius compensation ]: G41/42 NOT SUPPORTED. Error, if enabled while G53 is active.
     // [G40 Errors]: G2/3 arc is programmed after a G40. The linear move after disabling is less than tool diameter.
     //   NOTE: Since cutter radius compensation is never enabled, these G40 errors don't apply. Grbl supports G40
@@ -678,7 +866,7 @@ status_code_t gc_execute_line(char *line)
 
     // [16. Set path control mode ]: N/A. Only G61. G61.1 and G64 NOT SUPPORTED.
     // [17. Set distance mode ]: N/A. Only G91.1. G90.1 NOT SUPPORTED.
-    // [18. Set retract mode ]: NOT SUPPORTED.
+    // [18. Set retract mode ]: N/A. Only used by canned cycles.
 
     // [19. Remaining non-modal actions ]: Check go to predefined position, set G10, or set axis offsets.
     // NOTE: We need to separate the non-modal commands that are axis word-using (G10/G28/G30/G92), as these
@@ -833,6 +1021,9 @@ status_code_t gc_execute_line(char *line)
     } // end gc_block.non_modal_command
 
     // [20. Motion modes ]:
+    gc_canned_t canned;
+    gc_canned_words_t canned_words;
+
     if (gc_block.modal.motion == MotionMode_None) {
 
         // [G80 Errors]: Axis word are programmed while G80 is active.
@@ -1044,6 +1235,91 @@ status_code_t gc_execute_line(char *line)
                         FAIL(Status_GcodeInvalidTarget); // [Invalid target]
                     break;
 
+                case MotionMode_DrillChipBreak:
+                case MotionMode_CannedCycle81:
+                case MotionMode_CannedCycle82:
+                case MotionMode_CannedCycle83:
+                    // [G73/G81-83 Errors]: Feed rate undefined (done.) Plane not XY. Inverse time mode. Z or R word missing
+                    //   when entering the cycle. R plane not above hole bottom. Q word missing or negative for G73/G83. L0.
+                    // NOTE: Z, R, Q and P words are retained between blocks while a canned cycle is active. The L word is not.
+                    if (gc_block.modal.plane_select != PlaneSelect_XY || gc_block.modal.feed_mode == FeedMode_InverseTime)
+                        FAIL(Status_GcodeUnsupportedCommand); // [Only G17 and G94 supported]
+
+                    if (!axis_words) {
+                        axis_command = AxisCommand_None;
+                        break;
+                    }
+
+                    if (is_canned_cycle(gc_state.modal.motion))
+                        memcpy(&canned_words, &gc_state.canned, sizeof(gc_canned_words_t));
+                    else {
+                        if (bit_isfalse(value_words, bit(Word_R)) || bit_isfalse(axis_words, bit(Z_AXIS)))
+                            FAIL(Status_GcodeValueWordMissing); // [R or Z word missing]
+                        memset(&canned_words, 0, sizeof(gc_canned_words_t));
+                    }
+
+                    if (bit_istrue(axis_words, bit(Z_AXIS)))
+                        canned_words.z = cc_words[Z_AXIS];
+
+                    if (bit_istrue(value_words, bit(Word_R)))
+                        canned_words.r = gc_block.modal.units == UnitsMode_Inches ? gc_block.values.r * MM_PER_INCH : gc_block.values.r;
+
+                    if (bit_istrue(value_words, bit(Word_Q))) {
+                        if (gc_block.values.q < 0.0f)
+                            FAIL(Status_NegativeValue); // [Q word negative]
+                        canned_words.q = gc_block.modal.units == UnitsMode_Inches ? gc_block.values.q * MM_PER_INCH : gc_block.values.q;
+                    }
+
+                    if (bit_istrue(value_words, bit(Word_P)))
+                        canned_words.p = gc_block.values.p;
+
+                    if (canned_words.q == 0.0f && (gc_block.modal.motion == MotionMode_DrillChipBreak || gc_block.modal.motion == MotionMode_CannedCycle83))
+                        FAIL(Status_GcodeValueWordMissing); // [Q word missing]
+
+                    canned.repeats = 1;
+                    if (bit_istrue(value_words, bit(Word_L)) && (canned.repeats = gc_block.values.l) == 0)
+                        FAIL(Status_GcodeInvalidTarget); // [L0]
+
+                    bit_false(value_words, (bit(Word_R)|bit(Word_Q)|bit(Word_L)|bit(Word_P)));
+
+                    // Convert R plane and hole bottom to machine coordinates. In incremental mode R is relative to
+                    // the initial Z position and Z is relative to R. Holes are repeated in place in absolute mode.
+                    if (gc_block.modal.distance == DistanceMode_Absolute) {
+                        float z_offset = block_coord_system[Z_AXIS] + gc_state.coord_offset[Z_AXIS];
+                        if (TOOL_LENGTH_OFFSET_AXIS == Z_AXIS)
+                            z_offset += gc_state.tool_length_offset;
+                        canned.r_plane = canned_words.r + z_offset;
+                        canned.depth = canned_words.z + z_offset;
+                        clear_vector(canned.delta);
+                    } else {
+                        canned.r_plane = gc_state.position[Z_AXIS] + canned_words.r;
+                        canned.depth = canned.r_plane + canned_words.z;
+                        idx = N_AXIS;
+                        do {
+                            --idx;
+                            canned.delta[idx] = bit_istrue(axis_words, bit(idx)) && idx != Z_AXIS ? cc_words[idx] : 0.0f;
+                        } while(idx);
+                    }
+
+                    if (canned.depth >= canned.r_plane)
+                        FAIL(Status_GcodeInvalidTarget); // [R plane not above hole bottom]
+
+                    canned.retract = gc_block.modal.retract_mode == CCRetractMode_RPos
+                                      ? canned.r_plane
+                                      : max(gc_state.position[Z_AXIS], canned.r_plane);
+                    canned.step = gc_block.modal.motion == MotionMode_CannedCycle81 || gc_block.modal.motion == MotionMode_CannedCycle82 ? 0.0f : canned_words.q;
+                    canned.dwell = gc_block.modal.motion == MotionMode_CannedCycle82 ? canned_words.p : 0.0f;
+
+                    // Set target to the final position, the last hole at the retract plane, for the parser position update.
+                    memcpy(canned.xyz, gc_block.values.xyz, sizeof(canned.xyz));
+                    idx = N_AXIS;
+                    do {
+                        --idx;
+                        gc_block.values.xyz[idx] = canned.xyz[idx] + canned.delta[idx] * (canned.repeats - 1);
+                    } while(idx);
+                    gc_block.values.xyz[Z_AXIS] = canned.retract;
+                    break;
+
                 default:
 					break;
 
@@ -1063,6 +1339,16 @@ status_code_t gc_execute_line(char *line)
     if (axis_command)
         bit_false(value_words, AXIS_WORDS_MASK); // Remove axis words.
 
+  #ifdef PLANNER_EXIT_SPEED_HINTS
+    // The E exit speed hint is only used by G0-G3 motions, in units per minute as F.
+    if (bit_istrue(value_words, bit(Word_E)) && !gc_parser_flags.jog_motion &&
+         axis_command == AxisCommand_MotionMode && gc_block.modal.motion <= MotionMode_CcwArc) {
+        if (gc_block.modal.units == UnitsMode_Inches)
+            gc_block.values.e *= MM_PER_INCH;
+        bit_false(value_words, bit(Word_E));
+    }
+  #endif
+
     if (value_words)
         FAIL(Status_GcodeUnusedWords); // [Unused words]
 
@@ -1102,6 +1388,9 @@ status_code_t gc_execute_line(char *line)
         return (status_code_t)int_value;
     }
 
+    // Assign parameters set in the block, all references in the block have read the old values.
+    ngc_params_commit();
+
     // If in laser mode, setup laser power based on current and past parser conditions.
     if (settings.flags.laser_mode) {
 
@@ -1144,6 +1433,9 @@ status_code_t gc_execute_line(char *line)
     // [3. Set feed rate ]:
     gc_state.feed_rate = gc_block.values.f; // Always copy this value. See feed rate error-checking.
     plan_data.feed_rate = gc_state.feed_rate; // Record data for planner use.
+  #ifdef PLANNER_EXIT_SPEED_HINTS
+    plan_data.exit_speed = gc_block.values.e; // Zero if no hint.
+  #endif
 
     // [4. Set spindle speed ]:
     if ((gc_state.spindle_speed != gc_block.values.s) || gc_parser_flags.laser_force_sync) {
@@ -1290,6 +1582,7 @@ status_code_t gc_execute_line(char *line)
     // NOTE: Commands G10,G28,G30,G92 lock out and prevent axis words from use in motion modes.
     // Enter motion modes only if there are axis words or a motion mode command word in the block.
     gc_state.modal.motion = gc_block.modal.motion;
+    gc_state.modal.retract_mode = gc_block.modal.retract_mode;
 
     if (gc_state.modal.motion != MotionMode_None) {
 
@@ -1305,6 +1598,9 @@ status_code_t gc_execute_line(char *line)
             } else if ((gc_state.modal.motion == MotionMode_CwArc) || (gc_state.modal.motion == MotionMode_CcwArc)) {
                 mc_arc(gc_block.values.xyz, &plan_data, gc_state.position, gc_block.values.ijk, gc_block.values.r,
                         axis_0, axis_1, axis_linear, gc_parser_flags.arc_is_clockwise);
+            } else if (is_canned_cycle(gc_state.modal.motion)) {
+                memcpy(&gc_state.canned, &canned_words, sizeof(gc_canned_words_t));
+                mc_canned_drill(gc_state.modal.motion, gc_state.position, &canned, &plan_data);
             } else {
                 // NOTE: gc_block.values.xyz is returned from mc_probe_cycle with the updated position value. So
                 // upon a successful probing cycle, the machine position and the returned value should be the same.
@@ -1395,7 +1691,7 @@ status_code_t gc_execute_line(char *line)
 /*
   Not supported:
 
-  - Canned cycles
+  - Canned cycles other than G73 and G81-G83, canned cycles in other planes than XY
   - Tool radius compensation
   - A,B,C-axes
   - Evaluation of expressions
@@ -1406,13 +1702,12 @@ status_code_t gc_execute_line(char *line)
 
    (*) Indicates optional parameter, enabled through config.h and re-compile
    group 0 = {G92.2, G92.3} (Non modal: Cancel and re-enable G92 offsets)
-   group 1 = {G81 - G89} (Motion modes: Canned cycles)
+   group 1 = {G84 - G89} (Motion modes: Canned cycles, G73 and G81 - G83 are supported)
    group 4 = {M1} (Optional stop, ignored)
    group 6 = {M6} (Tool change)
    group 7 = {G41, G42} cutter radius compensation (G40 is supported)
    group 8 = {G43} tool length offset (G43.1/G49 are supported)
    group 8 = {M7*} enable mist coolant (* Compile-option)
    group 9 = {M48, M49, M56*} enable/disable override switches (* Compile-option)
-   group 10 = {G98, G99} return mode canned cycles
    group 13 = {G61.1, G64} path control mode (G61 is supported)
 */
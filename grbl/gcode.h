@@ -47,6 +47,7 @@ typedef enum {
     Status_InvalidJogCommand = 16,
     Status_SettingDisabledLaser = 17,
     Status_Reset = 18,
+    Status_SettingValueOutOfRange = 19,
 
     Status_GcodeUnsupportedCommand = 20,
     Status_GcodeModalGroupViolation = 21,
@@ -66,7 +67,22 @@ typedef enum {
     Status_GcodeNoOffsetsInPlane = 35,
     Status_GcodeUnusedWords = 36,
     Status_GcodeG43DynamicAxisError = 37,
-    Status_GcodeMaxValueExceeded = 38
+    Status_GcodeMaxValueExceeded = 38,
+    Status_LineSequenceError = 39,
+    Status_FlowControlSyntaxError = 40,
+    Status_FlowControlStackOverflow = 41,
+    Status_FlowControlOutOfMemory = 42,
+    Status_ExpressionSyntaxError = 43,
+    Status_ExpressionUnknownOp = 44,
+    Status_ExpressionDivideByZero = 45,
+    Status_ExpressionArgumentOutOfRange = 46,
+    Status_ExpressionStackOverflow = 47,
+    Status_ParameterInvalid = 48,
+    Status_FileOpenFail = 49,
+    Status_FileReadWriteFail = 50,
+    Status_BinaryBlockInvalid = 51,
+    Status_ResumeLineNotFound = 52,
+    Status_ResumeInFlowControl = 53
 } status_code_t;
 
 
@@ -78,7 +94,7 @@ typedef enum {
 // NOTE: Modal group define values must be sequential and starting from zero.
 typedef enum {
     ModalGroup_G0 = 0,  // [G4,G10,G28,G28.1,G30,G30.1,G53,G92,G92.1] Non-modal
-    ModalGroup_G1,      // [G0,G1,G2,G3,G38.2,G38.3,G38.4,G38.5,G80] Motion
+    ModalGroup_G1,      // [G0,G1,G2,G3,G38.2,G38.3,G38.4,G38.5,G73,G80,G81,G82,G83] Motion
     ModalGroup_G2,      // [G17,G18,G19] Plane selection
     ModalGroup_G3,      // [G90,G91] Distance mode
     ModalGroup_G4,      // [G91.1] Arc IJK distance mode
@@ -86,6 +102,7 @@ typedef enum {
     ModalGroup_G6,      // [G20,G21] Units
     ModalGroup_G7,      // [G40] Cutter radius compensation mode. G41/42 NOT SUPPORTED.
     ModalGroup_G8,      // [G43.1,G49] Tool length offset
+    ModalGroup_G10,     // [G98,G99] Canned cycle return mode
     ModalGroup_G12,     // [G54,G55,G56,G57,G58,G59] Coordinate system selection
     ModalGroup_G13,     // [G61] Control mode
 
@@ -113,7 +130,8 @@ typedef enum {
     Word_Q,
 	Word_A,
 	Word_B,
-	Word_C
+	Word_C,
+    Word_E
 } parameter_word_t;
 
 #if N_AXIS == 3
@@ -163,9 +181,15 @@ typedef enum {
     MotionMode_ProbeTowardNoError = 141,    // G38.3 (Do not alter value)
     MotionMode_ProbeAway = 142,             // G38.4 (Do not alter value)
     MotionMode_ProbeAwayNoError = 143,      // G38.5 (Do not alter value)
-    MotionMode_None = 80                    // G80 (Do not alter value)
+    MotionMode_DrillChipBreak = 73,         // G73 (Do not alter value)
+    MotionMode_None = 80,                   // G80 (Do not alter value)
+    MotionMode_CannedCycle81 = 81,          // G81 (Do not alter value)
+    MotionMode_CannedCycle82 = 82,          // G82 (Do not alter value)
+    MotionMode_CannedCycle83 = 83           // G83 (Do not alter value)
 } motion_mode_t;
 
+#define is_canned_cycle(motion) ((motion) == MotionMode_DrillChipBreak || ((motion) >= MotionMode_CannedCycle81 && (motion) <= MotionMode_CannedCycle83))
+
 // Modal Group G2: Plane select
 typedef enum {
     PlaneSelect_XY = 0, // G17 (Default: Must be zero)
@@ -206,6 +230,12 @@ typedef enum {
 // Modal Group G7: Cutter radius compensation mode
 //#define CUTTER_COMP_DISABLE 0 // G40 (Default: Must be zero)
 
+// Modal Group G10: Canned cycle return mode
+typedef enum {
+    CCRetractMode_Previous = 0, // G98 (Default: Must be zero)
+    CCRetractMode_RPos = 1      // G99 (Do not alter value)
+} cc_retract_mode_t;
+
 // Modal Group G13: Control mode
 //#define CONTROL_MODE_EXACT_PATH 0 // G61 (Default: Must be zero)
 
@@ -269,7 +299,7 @@ typedef union {
 
 // NOTE: When this struct is zeroed, the above defines set the defaults for the system.
 typedef struct {
-    motion_mode_t motion;           // {G0,G1,G2,G3,G38.2,G80}
+    motion_mode_t motion;           // {G0,G1,G2,G3,G38.2,G73,G80,G81,G82,G83}
     feed_mode_t feed_mode;          // {G93,G94}
     units_mode_t units;             // {G20,G21}
     distance_mode_t distance;       // {G90,G91}
@@ -277,6 +307,7 @@ typedef struct {
     plane_select_t plane_select;    // {G17,G18,G19}
     // uint8_t cutter_comp;         // {G40} NOTE: Don't track. Only default supported.
     tool_length_offset_t tool_length;   // {G43.1,G49}
+    cc_retract_mode_t retract_mode;     // {G98,G99}
     uint8_t coord_select;           // {G54,G55,G56,G57,G58,G59}
     // uint8_t control;             // {G61} NOTE: Don't track. Only default supported.
     program_flow_t program_flow;    // {M0,M1,M2,M30}
@@ -287,10 +318,13 @@ typedef struct {
 
 typedef struct {
     float f;         // Feed
+  #ifdef PLANNER_EXIT_SPEED_HINTS
+    float e;         // Exit speed hint
+  #endif
     float ijk[3];    // I,J,K Axis arc offsets
     float p;         // G10 or dwell parameters
-    float q;         // User defined M-code parameter (G82 peck drilling, not supported)
-    float r;         // Arc radius
+    float q;         // User defined M-code parameter or canned cycle peck increment
+    float r;         // Arc radius or canned cycle R plane
     float s;         // Spindle speed
     float xyz[N_AXIS]; // X,Y,Z Translational axes
     float coord_data[N_AXIS]; // Coordinate data
@@ -299,6 +333,26 @@ typedef struct {
     uint8_t l;       // G10 or canned cycles parameters
 } gc_values_t;
 
+// Canned cycle words, retained between blocks while a canned cycle motion mode is active. In mm,
+// Z and R are in program coordinates or, in incremental mode, relative to R and the initial Z.
+typedef struct {
+    float z;    // Hole depth
+    float r;    // R plane
+    float q;    // Peck increment, G73 and G83
+    float p;    // Dwell time in seconds at hole bottom, G82
+} gc_canned_words_t;
+
+// Canned cycle parameters for motion control, in machine coordinates.
+typedef struct {
+    float xyz[N_AXIS];      // Position of the first hole, Z is not used.
+    float delta[N_AXIS];    // Increment between holes when repeated in incremental mode (L word).
+    float r_plane;          // Z position of the R plane, drilling starts here.
+    float depth;            // Z position of the hole bottom.
+    float retract;          // Z position to retract to after each hole, the R plane (G99) or the initial Z if higher (G98).
+    float step;             // Peck increment, G73 and G83.
+    float dwell;            // Dwell time in seconds at hole bottom, G82.
+    uint8_t repeats;        // Number of holes.
+} gc_canned_t;
 
 typedef struct {
     gc_modal_t modal;
@@ -312,13 +366,14 @@ typedef struct {
     float coord_offset[N_AXIS];    // Retains the G92 coordinate offset (work coordinates) relative to
                                  // machine zero in mm. Non-persistent. Cleared upon reset and boot.
     float tool_length_offset;      // Tracks tool length offset value when enabled.
+    gc_canned_words_t canned;     // Canned cycle words retained between blocks.
     int32_t line_number;          // Last line number sent
     uint8_t tool;                 // Tracks tool number. NOT USED.
     bool laser_ppi_mode;
     bool is_pwm_rate_adjusted;
 } parser_state_t;
 
-extern parser_state_t gc_state;
+extern CORE_STATE parser_state_t gc_state;
 
 
 typedef struct {
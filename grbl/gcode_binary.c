@@ -0,0 +1,193 @@
+/*
+  gcode_binary.c - binary g-code block decoder
+  Part of Grbl
+
+  Copyright (c) 2017 Terje Io
+
+  Grbl is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  Grbl is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with Grbl.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+/*
+  Binary blocks are a compact encoding of g-code blocks made of plain words, see doc/script/gcode2bin.py
+  for the encoder. The decoded words are passed to the g-code parser in place of the words scanned from
+  a text line, so validation and execution are the same as for the equivalent text block.
+
+  The serial stream is 7-bit and some characters are realtime commands, so a block is sent as a line of
+  sextets, 6-bit values encoded as the characters 0x40 + value. Sextet 62 is sent as '>' since '~' is
+  the cycle start command. The line starts with GC_BINARY_BLOCK_PREFIX.
+
+  Numbers are variable length: 5 bits per sextet, least significant first, bit 5 set if more sextets
+  follow. Signed numbers are zigzag coded (0, -1, 1, -2, ... as 0, 1, 2, 3, ...).
+
+  A word is a tag sextet, the letter index 0 to 25 for A to Z plus 0x20 if delta coded, followed by
+  the value:
+
+    absolute: zigzag(mantissa) << 3 | decimals, value = mantissa * 10^-decimals
+    delta:    zigzag(mantissa - previous mantissa of the letter), the decimals of the letter are kept
+
+  A block starting with the repeat tag has the letters of the previous binary block, in the same
+  order, and only the delta coded values follow. The mantissa is limited to 8 digits as in
+  read_float(). The decoder state is kept until reset, text lines do not change it.
+*/
+
+#include "grbl.h"
+
+#ifdef GCODE_BINARY_BLOCKS
+
+#define BIN_TAG_REPEAT  26
+#define BIN_TAG_DELTA   0x20
+#define BIN_MORE        0x20
+#define BIN_LETTERS     26
+#define BIN_MAX_MANTISSA 99999999
+
+typedef struct {
+    int32_t mantissa[BIN_LETTERS];
+    uint8_t decimals[BIN_LETTERS];
+    uint32_t defined; // Letters with a value, required for delta coded words.
+    uint8_t letters[GC_BINARY_MAX_WORDS]; // Letters of the previous block.
+    uint_fast8_t n_letters;
+} gc_binary_state_t;
+
+typedef struct {
+    uint8_t letter;
+    uint8_t decimals;
+    int32_t mantissa;
+} gc_binary_undo_t;
+
+static CORE_STATE gc_binary_state_t state;
+static CORE_STATE gc_binary_word_t words[GC_BINARY_MAX_WORDS];
+
+void gc_binary_reset (void)
+{
+    memset(&state, 0, sizeof(gc_binary_state_t));
+}
+
+// Returns the value of the sextet at line[*pos], -1 if invalid or at end of line.
+static int_fast8_t read_sextet (char *line, uint32_t *pos)
+{
+    char c = line[(*pos)++];
+
+    return c >= 0x40 && c <= 0x7F ? c - 0x40 : (c == '>' ? 62 : -1);
+}
+
+static bool read_number (char *line, uint32_t *pos, uint32_t *value)
+{
+    int_fast8_t sextet;
+    uint_fast8_t shift = 0;
+
+    *value = 0;
+
+    do {
+        if (shift > 30 || (sextet = read_sextet(line, pos)) < 0)
+            return false;
+        *value |= (uint32_t)(sextet & 0x1F) << shift;
+        shift += 5;
+    } while (sextet & BIN_MORE);
+
+    return true;
+}
+
+inline static int32_t unzigzag (uint32_t value)
+{
+    return (int32_t)(value >> 1) ^ -(int32_t)(value & 1);
+}
+
+// Restores the state of the letters of a block that failed to decode.
+static status_code_t decode_fail (gc_binary_undo_t *undo, uint_fast8_t n, uint32_t defined)
+{
+    while (n--) {
+        state.mantissa[undo[n].letter] = undo[n].mantissa;
+        state.decimals[undo[n].letter] = undo[n].decimals;
+    }
+    state.defined = defined;
+
+    return Status_BinaryBlockInvalid;
+}
+
+status_code_t gc_binary_decode (char *line, gc_binary_word_t **block, uint_fast8_t *count)
+{
+    int_fast8_t tag;
+    int32_t mantissa;
+    uint32_t pos = 1, value, defined = state.defined;
+    uint_fast8_t n = 0, letter;
+    bool delta, repeat = false;
+    uint8_t letters[GC_BINARY_MAX_WORDS];
+    gc_binary_undo_t undo[GC_BINARY_MAX_WORDS];
+
+    // The state is updated while decoding and restored if the block is invalid.
+    while (line[pos] != '\0') {
+
+        if (n == (repeat ? state.n_letters : GC_BINARY_MAX_WORDS))
+            return decode_fail(undo, n, defined);
+
+        if (repeat) {
+            letter = state.letters[n];
+            delta = true;
+        } else {
+            if ((tag = read_sextet(line, &pos)) < 0)
+                return decode_fail(undo, n, defined);
+            if (tag == BIN_TAG_REPEAT && n == 0) {
+                repeat = true;
+                continue;
+            }
+            if ((letter = tag & ~BIN_TAG_DELTA) >= BIN_LETTERS)
+                return decode_fail(undo, n, defined);
+            delta = (tag & BIN_TAG_DELTA) != 0;
+        }
+
+        if (!read_number(line, &pos, &value))
+            return decode_fail(undo, n, defined);
+
+        undo[n].letter = letter;
+        undo[n].mantissa = state.mantissa[letter];
+        undo[n].decimals = state.decimals[letter];
+
+        if (delta) {
+            if (!(state.defined & bit(letter)))
+                return decode_fail(undo, n, defined);
+            mantissa = state.mantissa[letter] + unzigzag(value);
+        } else {
+            mantissa = unzigzag(value >> 3);
+            state.decimals[letter] = value & 0x07;
+            state.defined |= bit(letter);
+        }
+
+        state.mantissa[letter] = mantissa;
+        letters[n] = letter;
+
+        if (mantissa > BIN_MAX_MANTISSA || mantissa < -BIN_MAX_MANTISSA)
+            return decode_fail(undo, n + 1, defined);
+
+        words[n].letter = 'A' + letter;
+        words[n].value = decimal_to_float(mantissa < 0 ? -mantissa : mantissa, -(int32_t)state.decimals[letter]);
+        if (mantissa < 0)
+            words[n].value = -words[n].value;
+        n++;
+    }
+
+    if (repeat && n != state.n_letters)
+        return decode_fail(undo, n, defined);
+
+    // Block is valid, keep its letters for repeat blocks.
+    if (!repeat)
+        memcpy(state.letters, letters, n);
+    state.n_letters = n;
+
+    *block = words;
+    *count = n;
+
+    return Status_OK;
+}
+
+#endif
@@ -0,0 +1,44 @@
+/*
+  gcode_binary.h - binary g-code block decoder
+  Part of Grbl
+
+  Copyright (c) 2017 Terje Io
+
+  Grbl is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  Grbl is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with Grbl.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef gcode_binary_h
+#define gcode_binary_h
+
+// First character of a binary block, the rest of the line is not filtered by the protocol.
+#define GC_BINARY_BLOCK_PREFIX '&'
+
+// Max number of words in a binary block.
+#ifndef GC_BINARY_MAX_WORDS
+  #define GC_BINARY_MAX_WORDS 32
+#endif
+
+typedef struct {
+    char letter;
+    float value;
+} gc_binary_word_t;
+
+// Clears the decoder state, called on startup and reset.
+void gc_binary_reset (void);
+
+// Decodes the binary block in line to words, returned in block and count. The words are only
+// valid until the next call.
+status_code_t gc_binary_decode (char *line, gc_binary_word_t **block, uint_fast8_t *count);
+
+#endif
@@ -44,12 +44,18 @@
 #include "eeprom.h"
 #include "eeprom_emulate.h"
 #include "gcode.h"
+#include "gcode_binary.h"
 #include "limits.h"
 #include "planner.h"
 #include "motion_control.h"
 #include "print.h"
 #include "probe.h"
 #include "protocol.h"
+#include "validate.h"
+#include "ngc_expr.h"
+#include "ngc_params.h"
+#include "ngc_flowctrl.h"
+#include "job.h"
 #include "report.h"
 #include "serial.h"
 #include "spindle_control.h"
@@ -57,6 +63,7 @@
 #include "jog.h"
 #include "system.h"
 #include "override.h"
+#include "arena.h"
 
 // ---------------------------------------------------------------------------------------
 // COMPILE-TIME ERROR CHECKING OF DEFINE VALUES:
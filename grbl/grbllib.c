@@ -24,14 +24,15 @@
 // #include "noeeprom.h" // uncomment to enable EEPROM emulation
 
 // Declare system global variable structure
-system_t sys;
-int32_t sys_position[N_AXIS];         // Real-time machine (aka home) position vector in steps.
-int32_t sys_probe_position[N_AXIS];   // Last probe position in machine coordinates and steps.
-volatile uint8_t sys_probe_state;     // Probing state value.  Used to coordinate the probing cycle with stepper ISR.
-volatile uint8_t sys_rt_exec_state;   // Global realtime executor bitflag variable for state management. See EXEC bitmasks.
-volatile uint8_t sys_rt_exec_alarm;   // Global realtime executor bitflag variable for setting various alarms.
+CORE_STATE system_t sys;
+CORE_STATE int32_t sys_position[N_AXIS];         // Real-time machine (aka home) position vector in steps.
+CORE_STATE int32_t sys_probe_position[N_AXIS];   // Last probe position in machine coordinates and steps.
+CORE_STATE volatile uint8_t sys_probe_state;     // Probing state value.  Used to coordinate the probing cycle with stepper ISR.
+CORE_STATE volatile uint8_t sys_rt_exec_state;   // Global realtime executor bitflag variable for state management. See EXEC bitmasks.
+CORE_STATE volatile uint8_t sys_rt_exec_alarm;   // Global realtime executor bitflag variable for setting various alarms.
+CORE_STATE volatile uint8_t sys_rt_exec_report;  // Global realtime executor bitflag variable for report requests. See EXEC bitmasks.
 
-HAL hal;
+CORE_STATE HAL hal;
 
 int grbl_enter (void)
 {
@@ -40,13 +41,16 @@ int grbl_enter (void)
 
 	memset(&hal, 0, sizeof(HAL));  // Clear...
 
-	hal.version = 3; // Update when signatures and/or contract is changed - driver_init() should fail
+	hal.version = 5; // Update when signatures and/or contract is changed - driver_init() should fail
 
 	driver_ok = driver_init();
 
 	hal.limit_interrupt_callback = &limit_interrupt_handler;
 	hal.control_interrupt_callback = &control_interrupt_handler;
 	hal.stepper_interrupt_callback = &stepper_driver_interrupt_handler;
+  #ifdef STEPPER_PREP_INTERRUPT
+	hal.stepper_prep_callback = &st_prep_buffer;
+  #endif
 	hal.protocol_process_realtime = &protocol_process_realtime;
 	hal.protocol_enqueue_gcode = &protocol_enqueue_gcode;
 
@@ -84,8 +88,11 @@ int grbl_enter (void)
 #endif
 
 #ifdef ADAPTIVE_MULTI_AXIS_STEP_SMOOTHING
-    driver_ok = driver_ok && hal.driver_cap.amass_level >= MAX_AMASS_LEVEL;
-    hal.driver_cap.amass_level = MAX_AMASS_LEVEL;
+    // The number of active AMASS levels is a setting, limit it to what both the driver and the core supports.
+    if (hal.driver_cap.amass_level > MAX_AMASS_LEVEL)
+        hal.driver_cap.amass_level = MAX_AMASS_LEVEL;
+    if (settings.amass_levels > hal.driver_cap.amass_level)
+        settings.amass_levels = hal.driver_cap.amass_level;
 #else
     hal.driver_cap.amass_level = 0;
 #endif
@@ -159,9 +166,19 @@ int grbl_enter (void)
 		sys_probe_state = 0;
 		sys_rt_exec_state = 0;
 		sys_rt_exec_alarm = 0;
+		sys_rt_exec_report = 0;
 
 		flush_override_buffers();
 
+		// Keep segment prep out while the buffers are carved and reset, a prep request may be pending.
+		st_prep_lock();
+
+		// Carve buffers from the arena, sized from settings.
+		if(!arena_init()) {
+            serial_write_string("Grbl: insufficient memory for buffers\r\n");
+            while(true);
+		}
+
 		// Reset Grbl primary systems.
 		serial_reset_read_buffer(); // Clear serial read buffer
 		gc_init(); // Set g-code parser to default state
@@ -169,6 +186,8 @@ int grbl_enter (void)
 		plan_reset(); // Clear block buffer and planner variables
 		st_reset(); // Clear stepper subsystem variables.
 
+		st_prep_unlock();
+
 		// Sync cleared gcode and planner positions to current system position.
 		plan_sync_position();
 		gc_sync_position();
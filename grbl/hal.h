@@ -33,6 +33,7 @@
 #include "coolant_control.h"
 #include "spindle_control.h"
 #include "eeprom.h"
+#include "job.h"
 
 //#define bit_true_atomic(var, bit) HWREGBITW(&var, bit) = 1;
 //#define bit_false_atomic(var, bit) HWREGBITW(&var, bit) = 0;
@@ -50,9 +51,8 @@ typedef union {
                  limits_pull_up          :1,
                  control_pull_up         :1,
                  probe_pull_up           :1,
-                 amass_level             :2, // 0...3
+                 amass_level             :3, // 0...6
         		 stepper_current_control :1,
-        		 unused12				 :1,
         		 unused13				 :1,
         		 unused14            	 :1,
         		 unused15				 :1;
@@ -107,23 +107,32 @@ typedef struct HAL {
     bool (*driver_release)(void);
     void (*execute_realtime)(uint8_t state);
 	uint8_t (*userdefined_mcode_check)(uint8_t mcode);
-	status_code_t (*userdefined_mcode_validate)(parser_block_t *gc_block, uint16_t *value_words);
+	status_code_t (*userdefined_mcode_validate)(parser_block_t *gc_block, uint32_t *value_words);
     void (*userdefined_mcode_execute)(uint8_t state, parser_block_t *gc_block);
     void (*userdefined_rt_command_execute)(uint8_t cmd);
     bool (*get_position)(int32_t (*position)[N_AXIS]);
+    uint32_t (*get_elapsed_ticks)(void); // millisecond tick counter, required for status auto reports
+    void (*stepper_prep_request)(void); // pend low priority interrupt calling stepper_prep_callback, see STEPPER_PREP_INTERRUPT
     eeprom_io_t eeprom;
+    file_io_t file; // optional, job storage for $F commands, disabled if open is not set
 
 	// callbacks - set up by library before MCU init
     bool (*protocol_enqueue_gcode)(char *data);
 	bool (*protocol_process_realtime)(int32_t data);
 	void (*stepper_interrupt_callback)(void);
+	void (*stepper_prep_callback)(void);
 	void (*limit_interrupt_callback)(axes_signals_t state);
 	void (*control_interrupt_callback)(control_signals_t signals);
 
 	driver_cap_t driver_cap;
+
+	// optional members, appended at the end to keep the offsets of the members above
+	uint8_t *arena;       // optional, 32-bit aligned RAM for the planner, segment and line buffers
+	uint32_t arena_size;  // size of the above in bytes, core uses an internal block of ARENA_SIZE bytes if not set
+	void (*serial_write_buffer)(const char *s, uint16_t length); // bulk write, core uses serial_write_string() if not provided
 } HAL;
 
-extern HAL hal;
+extern CORE_STATE HAL hal;
 extern bool driver_init (void);
 
 #endif
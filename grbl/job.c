@@ -0,0 +1,313 @@
+/*
+  job.c - job storage, upload and execution of g-code files from local storage
+  Part of Grbl
+
+  Copyright (c) 2017 Terje Io
+
+  Grbl is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  Grbl is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with Grbl.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+/*
+  Jobs are uploaded once and then run from the storage provided by the driver (hal.file), taking the
+  serial link and host out of the motion path. When a job is running the main loop reads its characters
+  from the read-ahead buffer instead of from the serial stream, lines are thus filtered and executed
+  exactly as streamed lines. Only the end of the job is reported, with the number of lines executed and
+  the status of the last line. Realtime commands are still accepted from the serial stream, a reset
+  stops the job.
+
+  Uploaded lines are stored as filtered by the main loop: without spaces or comments and upcased.
+  $ commands are stored as well. An upload is ended by $FW without a name, not by a '%' line since CAM
+  programs often start with one. '%' lines are not stored. An upload interrupted by a reset or a write error is deleted.
+
+  A job may be resumed at a line, e.g. after a tool break. The lines before it are executed in check
+  mode, at parser speed, to rebuild the parser state: modal groups, work coordinate system, offsets,
+  spindle, coolant, feed rate and position. The rebuilt state is reported, then the spindle and coolant
+  are restored and the machine moves to the position at the end of the previous line before the job
+  continues. After a tool break the tool is usually still at cutting depth, so Z is first raised to the
+  clearance height: the G28 Z position set with G28.1, or the current or resume Z if higher. The other
+  axes then move at rapid rate and finally Z moves down at the programmed feed rate.
+*/
+
+#include "grbl.h"
+
+typedef enum {
+    Job_Idle = 0,
+    Job_Running,
+    Job_Uploading
+} job_state_t;
+
+static CORE_STATE struct {
+    job_state_t state;
+    uint8_t *buffer;
+    uint32_t size;
+    uint32_t head;  // Index of next character to read.
+    uint32_t tail;  // Number of characters in buffer.
+    uint32_t lines; // Lines read, the current line included.
+    uint32_t resume_line; // Line to resume at, lines before it are executed in check mode. 0 if none.
+    char last;      // Last character read.
+    char name[JOB_FILENAME_LENGTH + 1]; // File being uploaded.
+} job;
+
+uint32_t job_buffer_size (void)
+{
+    return hal.file.open ? JOB_READ_AHEAD_SIZE : 0;
+}
+
+void job_buffer_init (uint8_t *buffer, uint32_t size)
+{
+    if (job.state != Job_Idle) {
+        hal.file.close();
+        if (job.state == Job_Uploading)
+            hal.file.remove(job.name); // Partial file.
+    }
+
+    memset(&job, 0, sizeof(job));
+    job.buffer = buffer;
+    job.size = size;
+}
+
+static void job_end (status_code_t status)
+{
+    hal.file.close();
+    job.state = Job_Idle;
+    report_job_end(job.lines, status);
+
+    // A resume that failed leaves check mode with a reset, which discards the rebuilt parser state.
+    if (job.resume_line) {
+        job.resume_line = 0;
+        mc_reset();
+    }
+}
+
+// Leaves check mode at the resume line, reports the rebuilt parser state and moves to the position
+// at the end of the previous line with the spindle and coolant restored.
+static status_code_t job_resume (void)
+{
+    float target[N_AXIS], clearance[N_AXIS], z;
+    plan_line_data_t plan_data;
+    bool plunge;
+
+    // Lines of a subroutine definition or loop before the resume line are only recorded, a loop would
+    // be executed in full, the lines before the resume line included, when closed.
+    if (ngc_flowctrl_recording())
+        return Status_ResumeInFlowControl;
+
+    system_convert_array_steps_to_mpos(target, sys_position);
+
+    // The tool is retracted to the G28 Z position, or the current or resume Z if higher, before moving across.
+    // A G28 position that can not be read is reset to machine zero, the top of Z travel after homing.
+    settings_read_coord_data(SETTING_INDEX_G28, clearance);
+
+    z = max(clearance[Z_AXIS], max(target[Z_AXIS], gc_state.position[Z_AXIS]));
+
+    // The last move down is a feed motion, its rate must be known before moving.
+    if ((plunge = gc_state.position[Z_AXIS] < z) &&
+         (gc_state.modal.feed_mode == FeedMode_InverseTime || gc_state.feed_rate <= 0.0f))
+        return Status_GcodeUndefinedFeedRate;
+
+    job.resume_line = 0;
+    sys.state = STATE_IDLE;
+
+    report_job_resume(job.lines + 1, gc_state.position);
+    report_gcode_modes();
+    report_ngc_parameters();
+
+    if (gc_state.modal.spindle.on && !settings.flags.laser_mode) {
+        spindle_set_state(gc_state.modal.spindle, gc_state.spindle_speed);
+        delay_sec(SAFETY_DOOR_SPINDLE_DELAY, DelayMode_Dwell);
+    }
+
+    if (gc_state.modal.coolant.value) {
+        coolant_set_state(gc_state.modal.coolant);
+        delay_sec(SAFETY_DOOR_COOLANT_DELAY, DelayMode_Dwell);
+    }
+
+    memset(&plan_data, 0, sizeof(plan_line_data_t));
+    plan_data.spindle_speed = gc_state.spindle_speed;
+    plan_data.condition.coolant = gc_state.modal.coolant;
+    if (!settings.flags.laser_mode) // Laser is kept off during the approach.
+        plan_data.condition.spindle = gc_state.modal.spindle;
+    plan_data.condition.rapid_motion = on;
+
+    plan_sync_position();
+
+    if (target[Z_AXIS] < z) {
+        target[Z_AXIS] = z;
+        mc_line(target, &plan_data);
+    }
+
+    memcpy(target, gc_state.position, sizeof(target));
+    target[Z_AXIS] = z;
+    mc_line(target, &plan_data);
+
+    if (plunge) {
+        plan_data.condition.rapid_motion = off;
+        plan_data.feed_rate = gc_state.feed_rate;
+        mc_line(gc_state.position, &plan_data);
+    }
+
+    return Status_OK;
+}
+
+status_code_t job_execute_command (char *line)
+{
+    char cmd = line[2], name[JOB_FILENAME_LENGTH + 1];
+    uint32_t idx = 0, size, resume_line = 0;
+
+    if (!hal.file.open)
+        return Status_SettingDisabled;
+
+    if (job.state == Job_Uploading && cmd == 'W' && line[3] == '\0') { // End upload
+        hal.file.close();
+        job.state = Job_Idle;
+        return Status_OK;
+    }
+
+    if (job.state != Job_Idle)
+        return Status_IdleError;
+
+    if (cmd == '\0') { // List files [IDLE/ALARM/CHECK]
+        if (sys.state & (STATE_CYCLE | STATE_HOLD))
+            return Status_IdleError; // Block during cycle. Takes too long to print.
+        while (hal.file.list(idx++, name, &size))
+            report_file(name, size);
+        return Status_OK;
+    }
+
+    // Line to resume at for $FR<line>=<name>.
+    idx = 3;
+    if (cmd == 'R') while (line[idx] >= '0' && line[idx] <= '9')
+        resume_line = resume_line * 10 + (line[idx++] - '0');
+
+    if (line[idx] != '=' || line[idx + 1] == '\0' || strlen(&line[idx + 1]) > JOB_FILENAME_LENGTH)
+        return Status_InvalidStatement;
+
+    line += idx + 1;
+
+    switch (cmd) {
+
+        case 'R': // Run file [IDLE/CHECK], resume at line [IDLE]
+            if (sys.state != STATE_IDLE && (sys.state != STATE_CHECK_MODE || resume_line > 1))
+                return Status_IdleError;
+            if (resume_line > 1)
+                protocol_buffer_synchronize(); // The approach starts from the machine position.
+            if (!hal.file.open(line, FileMode_Read))
+                return Status_FileOpenFail;
+            job.head = job.tail = job.lines = 0;
+            job.last = '\n';
+            job.state = Job_Running;
+            if ((job.resume_line = resume_line > 1 ? resume_line : 0))
+                sys.state = STATE_CHECK_MODE;
+            break;
+
+        case 'W': // Upload file [IDLE/ALARM]
+            if (sys.state != STATE_IDLE && sys.state != STATE_ALARM)
+                return Status_IdleError;
+            if (!hal.file.open(line, FileMode_Write))
+                return Status_FileOpenFail;
+            strcpy(job.name, line);
+            job.state = Job_Uploading;
+            break;
+
+        case 'D': // Delete file [IDLE/ALARM]
+            if (sys.state != STATE_IDLE && sys.state != STATE_ALARM)
+                return Status_IdleError;
+            if (!hal.file.remove(line))
+                return Status_FileOpenFail;
+            break;
+
+        default:
+            return Status_InvalidStatement;
+    }
+
+    return Status_OK;
+}
+
+bool job_running (void)
+{
+    return job.state == Job_Running;
+}
+
+bool job_resuming (void)
+{
+    return job.resume_line != 0;
+}
+
+int32_t job_read (void)
+{
+    int32_t c;
+
+    if (job.head == job.tail) {
+
+        if ((c = hal.file.read(job.buffer, job.size)) <= 0) {
+            // Terminate the last line if the file does not end with a line feed.
+            if (c == 0 && job.last != '\n' && job.last != '\r') {
+                c = job.last = '\n';
+                job.lines++;
+            } else {
+                job_end(c != 0 ? Status_FileReadWriteFail : (job.resume_line ? Status_ResumeLineNotFound : Status_OK));
+                c = SERIAL_NO_DATA;
+            }
+            return c;
+        }
+
+        job.head = 0;
+        job.tail = (uint32_t)c;
+    }
+
+    c = job.buffer[job.head++];
+
+    // The previous line has been executed when the first character of the resume line is read.
+    if (job.resume_line == job.lines + 1 && (job.last == '\n' || (job.last == '\r' && c != '\n'))) {
+        status_code_t status;
+        if ((status = job_resume()) != Status_OK) {
+            job_end(status);
+            return SERIAL_NO_DATA;
+        }
+    }
+
+    // Count lines at their end, a CR LF pair ends one line.
+    if (c == '\r' || (c == '\n' && job.last != '\r'))
+        job.lines++;
+
+    job.last = (char)c;
+
+    return c;
+}
+
+void job_line_status (status_code_t status)
+{
+    if (status != Status_OK && job.state == Job_Running)
+        job_end(status);
+}
+
+bool job_uploading (void)
+{
+    return job.state == Job_Uploading;
+}
+
+status_code_t job_write_line (char *line)
+{
+    if (line[0] == '%' && line[1] == '\0') // Program start/end marker, would stop the job when run.
+        return Status_OK;
+
+    if (!(hal.file.write((uint8_t *)line, strlen(line)) && hal.file.write((uint8_t *)"\n", 1))) {
+        hal.file.close();
+        hal.file.remove(job.name);
+        job.state = Job_Idle;
+        return Status_FileReadWriteFail;
+    }
+
+    return Status_OK;
+}
@@ -0,0 +1,79 @@
+/*
+  job.h - job storage, upload and execution of g-code files from local storage
+  Part of Grbl
+
+  Copyright (c) 2017 Terje Io
+
+  Grbl is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  Grbl is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with Grbl.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef job_h
+#define job_h
+
+// Size of the read-ahead buffer for jobs run from storage, carved from the arena if the driver
+// provides file storage.
+#ifndef JOB_READ_AHEAD_SIZE
+  #define JOB_READ_AHEAD_SIZE 512
+#endif
+
+// Max length of file names, excluding the terminator.
+#ifndef JOB_FILENAME_LENGTH
+  #define JOB_FILENAME_LENGTH 31
+#endif
+
+typedef enum {
+    FileMode_Read = 0,
+    FileMode_Write
+} file_mode_t;
+
+// File storage provided by the driver, a flash filesystem or SD card on target or a directory
+// on a host build. Only one file is open at a time.
+typedef struct {
+    bool (*open)(const char *name, file_mode_t mode); // Write mode creates or truncates the file.
+    int32_t (*read)(uint8_t *data, uint32_t size);    // Returns bytes read, 0 at end of file or < 0 on error.
+    bool (*write)(const uint8_t *data, uint32_t size);
+    void (*close)(void);
+    bool (*remove)(const char *name);
+    bool (*list)(uint32_t idx, char *name, uint32_t *size); // Returns false when idx is past the last file.
+} file_io_t;
+
+// Returns the memory required for the read-ahead buffer, 0 if the driver has no file storage. Called by the arena.
+uint32_t job_buffer_size (void);
+
+// Sets the read-ahead buffer, called by the arena on startup and reset. Stops any job or upload in progress.
+void job_buffer_init (uint8_t *buffer, uint32_t size);
+
+// Executes the $F commands: $F lists files, $FW=<name> uploads and $FW ends the upload, $FR=<name> runs,
+// $FR<line>=<name> resumes at a line and $FD=<name> deletes a file.
+status_code_t job_execute_command (char *line);
+
+// Returns true if a job is running, its lines are then read with job_read() instead of from the serial stream.
+bool job_running (void);
+
+// Returns true while the lines before the resume line of a job are executed in check mode.
+bool job_resuming (void);
+
+// Returns the next character of the running job, or SERIAL_NO_DATA when it ends.
+int32_t job_read (void);
+
+// Records the result of a line of the running job, the job is stopped on error.
+void job_line_status (status_code_t status);
+
+// Returns true if an upload is in progress, lines are then stored with job_write_line() instead of executed.
+bool job_uploading (void);
+
+// Stores a line of the file being uploaded, lines with a single '%' are skipped. $FW ends the upload.
+status_code_t job_write_line (char *line);
+
+#endif
@@ -224,7 +224,9 @@ void limits_go_home (uint8_t cycle_mask)
 
         } while (AXES_BITMASK & axislock);
 
+        st_prep_lock();
         st_reset(); // Immediately force kill steppers and reset step segment buffer.
+        st_prep_unlock();
         delay_ms(settings.homing_debounce_delay); // Delay to allow transient dynamics to dissipate.
 
         // Reverse direction and reset homing rate for locate cycle(s).
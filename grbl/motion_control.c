@@ -21,6 +21,51 @@
 
 #include "grbl.h"
 
+// Parse queue, lines parsed and validated ahead of the planner. When the planner buffer is full,
+// lines are staged here so the parser can keep consuming input. Carved from the arena.
+typedef struct {
+    float target[N_AXIS];
+    plan_line_data_t pl_data;
+} queued_line_t;
+
+static CORE_STATE queued_line_t *line_queue = NULL;
+static CORE_STATE uint_fast8_t queue_lines = 0, queue_head = 0, queue_tail = 0, queue_count = 0;
+
+
+// Returns the memory required for a parse queue of the given number of lines. Called by the arena.
+uint32_t mc_queue_size (uint32_t lines)
+{
+    return lines * sizeof(queued_line_t);
+}
+
+
+// Sets the parse queue, called by the arena on startup and reset. Zero lines disables the queue.
+void mc_queue_init (void *buffer, uint32_t lines)
+{
+    line_queue = (queued_line_t *)buffer;
+    queue_lines = lines;
+    mc_queue_reset();
+}
+
+
+// Discards all queued lines.
+void mc_queue_reset ()
+{
+    queue_head = queue_tail = queue_count = 0;
+}
+
+
+// Moves queued lines to the planner buffer while there is room. Called from protocol_execute_realtime().
+void mc_queue_drain ()
+{
+    while(queue_count && !plan_check_full_buffer()) {
+        plan_buffer_line(line_queue[queue_tail].target, &line_queue[queue_tail].pl_data);
+        if(++queue_tail == queue_lines)
+            queue_tail = 0;
+        queue_count--;
+    }
+}
+
 
 // Execute linear motion in absolute millimeter coordinates. Feed rate given in millimeters/second
 // unless invert_feed_rate is true. Then the feed_rate means that the motion should be completed in
@@ -31,6 +76,12 @@
 // in the planner and to let backlash compensation or canned cycle integration simple and direct.
 void mc_line(float *target, plan_line_data_t *pl_data)
 {
+    // When validating a job in check mode the motion is only recorded for the summary,
+    // soft limit violations are counted instead of raising an alarm.
+    if (sys.validating) {
+        validate_motion(target);
+        return;
+    }
 
     // If enabled, check for soft limit violations. Placed here all line motions are picked up
     // from everywhere in Grbl.
@@ -55,12 +106,43 @@ void mc_line(float *target, plan_line_data_t *pl_data)
         // doesn't update the machine position values. Since the position values used by the g-code
         // parser and planner are separate from the system machine positions, this is doable.
 
-        // If the buffer is full: good! That means we are well ahead of the robot.
-        // Remain in this loop until there is room in the buffer.
-        while(plan_check_full_buffer()) {
-            protocol_auto_cycle_start();     // Auto-cycle start when buffer is full.
-            if(!protocol_execute_realtime()) // Check for any run-time commands
-                return;                      // Bail, if system abort.
+        if(queue_lines) {
+
+            // If the parse queue is full too the parser is well ahead of the robot.
+            // Remain in this loop until a line has moved on to the planner buffer.
+            if(queue_count == queue_lines)
+                report_ack_flush(); // Acknowledge coalesced lines before waiting.
+
+            while(queue_count == queue_lines) {
+                protocol_auto_cycle_start();     // Auto-cycle start when buffer is full.
+                if(!protocol_execute_realtime()) // Check for any run-time commands, drains the queue.
+                    return;                      // Bail, if system abort.
+            }
+
+            // Stage the line if the planner buffer is full or earlier lines are still queued, the parser
+            // may then continue with the next line while the planner drains.
+            if(queue_count || plan_check_full_buffer()) {
+                memcpy(line_queue[queue_head].target, target, sizeof(line_queue[queue_head].target));
+                memcpy(&line_queue[queue_head].pl_data, pl_data, sizeof(plan_line_data_t));
+                if(++queue_head == queue_lines)
+                    queue_head = 0;
+                queue_count++;
+                protocol_auto_cycle_start(); // Auto-cycle start when buffer is full.
+                return;
+            }
+
+        } else {
+
+            // If the buffer is full: good! That means we are well ahead of the robot.
+            // Remain in this loop until there is room in the buffer.
+            if(plan_check_full_buffer())
+                report_ack_flush(); // Acknowledge coalesced lines before waiting.
+
+            while(plan_check_full_buffer()) {
+                protocol_auto_cycle_start();     // Auto-cycle start when buffer is full.
+                if(!protocol_execute_realtime()) // Check for any run-time commands
+                    return;                      // Bail, if system abort.
+            }
         }
 
         // Plan and queue motion into planner buffer
@@ -154,6 +236,31 @@ void mc_arc (float *target, plan_line_data_t *pl_data, float *position, float *o
         float r_axisi;
         uint32_t i, count = 0;
 
+      #ifdef PLANNER_EXIT_SPEED_HINTS
+        // Hint the segments to exit at a speed from where the exit speed of the arc, zero or its hint, can be
+        // reached at its end. Computed from lower bounds of the values computed by the planner: the lowest axis
+        // acceleration, and the segment length and junction speed between segments allowing for the rounding
+        // of the segment end points to steps.
+        float exit_speed = pl_data->exit_speed, exit_speed_sqr = exit_speed * exit_speed;
+        float acceleration = min(settings.acceleration[axis_0], settings.acceleration[axis_1]);
+        float step_mm = max(1.0f / settings.steps_per_mm[axis_0], 1.0f / settings.steps_per_mm[axis_1]);
+        if (linear_per_segment != 0.0f) {
+            acceleration = min(acceleration, settings.acceleration[axis_linear]);
+            step_mm = max(step_mm, 1.0f / settings.steps_per_mm[axis_linear]);
+        }
+        float segment_mm = hypotf(2.0f * radius * sinf(0.5f * fabsf(theta_per_segment)), linear_per_segment);
+        float rounding_mm = 2.0f * step_mm; // Max error of a segment from rounding its end points.
+        float junction_speed_sqr = 0.0f, segment_speed_sqr = 0.0f;
+        if (segment_mm > rounding_mm) {
+            float theta = fabsf(theta_per_segment) + 2.0f * asinf(rounding_mm / segment_mm); // Max junction angle.
+            if (theta < M_PI) {
+                float cos_theta_d2 = cosf(0.5f * theta);
+                junction_speed_sqr = acceleration * settings.junction_deviation * cos_theta_d2 / (1.0f - cos_theta_d2);
+                segment_speed_sqr = 2.0f * acceleration * (segment_mm - rounding_mm);
+            }
+        }
+      #endif
+
         for (i = 1; i < segments; i++) { // Increment (segments-1).
 
             if (count < N_ARC_CORRECTION) {
@@ -177,18 +284,98 @@ void mc_arc (float *target, plan_line_data_t *pl_data, float *position, float *o
             position[axis_1] = center_axis1 + r_axis1;
             position[axis_linear] += linear_per_segment;
 
+          #ifdef PLANNER_EXIT_SPEED_HINTS
+            pl_data->exit_speed = sqrtf(min(junction_speed_sqr, exit_speed_sqr + segment_speed_sqr * (float)(segments - i)));
+          #endif
+
             mc_line(position, pl_data);
 
             // Bail mid-circle on system abort. Runtime command check already performed by mc_line.
             if (sys.abort)
                 return;
         }
+
+      #ifdef PLANNER_EXIT_SPEED_HINTS
+        pl_data->exit_speed = exit_speed;
+      #endif
     }
     // Ensure last segment arrives at target location.
     mc_line(target, pl_data);
 }
 
 
+// Execute canned drilling cycle G73, G81, G82 or G83 in the XY plane. Positions are in machine coordinates.
+// position == current position, canned holds the first hole position, R and retract planes, hole bottom, peck
+// increment, dwell and the number of holes. Each hole is drilled from the R plane, the tool is moved to the next
+// hole at the retract plane. G73 retracts by CANNED_CYCLE_PECK_CLEARANCE between pecks to break chips, G83 fully
+// retracts to the R plane and rapids back to just above the previous depth.
+void mc_canned_drill (motion_mode_t motion, float *position, gc_canned_t *canned, plan_line_data_t *pl_data)
+{
+    uint_fast8_t idx;
+    float target[N_AXIS], current_depth;
+
+    memcpy(target, position, sizeof(target));
+
+    // If below the R plane, rapid up to it before moving to the first hole.
+    pl_data->condition.rapid_motion = on;
+    if (target[Z_AXIS] < canned->r_plane) {
+        target[Z_AXIS] = canned->r_plane;
+        mc_line(target, pl_data);
+    }
+
+    while (canned->repeats--) {
+
+        // Rapid to hole position, then down to the R plane.
+        pl_data->condition.rapid_motion = on;
+        for (idx = 0; idx < N_AXIS; idx++) {
+            if (idx != Z_AXIS)
+                target[idx] = canned->xyz[idx];
+        }
+        mc_line(target, pl_data);
+
+        target[Z_AXIS] = canned->r_plane;
+        mc_line(target, pl_data);
+
+        current_depth = canned->r_plane;
+
+        do {
+            // Feed to next peck depth or hole bottom.
+            current_depth = canned->step > 0.0f ? max(current_depth - canned->step, canned->depth) : canned->depth;
+            pl_data->condition.rapid_motion = off;
+            target[Z_AXIS] = current_depth;
+            mc_line(target, pl_data);
+
+            // Bail mid-cycle on system abort. Runtime command check already performed by mc_line.
+            if (sys.abort)
+                return;
+
+            if (current_depth > canned->depth) {
+                pl_data->condition.rapid_motion = on;
+                if (motion == MotionMode_CannedCycle83) {
+                    target[Z_AXIS] = canned->r_plane;
+                    mc_line(target, pl_data);
+                }
+                target[Z_AXIS] = min(current_depth + CANNED_CYCLE_PECK_CLEARANCE, canned->r_plane);
+                mc_line(target, pl_data);
+            }
+        } while (current_depth > canned->depth);
+
+        if (canned->dwell > 0.0f)
+            mc_dwell(canned->dwell);
+
+        pl_data->condition.rapid_motion = on;
+        target[Z_AXIS] = canned->retract;
+        mc_line(target, pl_data);
+
+        if (sys.abort)
+            return;
+
+        for (idx = 0; idx < N_AXIS; idx++)
+            canned->xyz[idx] += canned->delta[idx];
+    }
+}
+
+
 // Execute dwell in seconds.
 void mc_dwell (float seconds)
 {
@@ -318,9 +505,11 @@ gc_probe_t mc_probe_cycle (float *target, plan_line_data_t *pl_data, gc_parser_f
     protocol_execute_realtime();   // Check and execute run-time commands
 
     // Reset the stepper and planner buffers to remove the remainder of the probe motion.
+    st_prep_lock();
     st_reset(); // Reset step segment buffer.
     plan_reset(); // Reset planner buffer. Zero planner positions. Ensure probing motion is cleared.
     plan_sync_position(); // Sync planner position to current machine position.
+    st_prep_unlock();
 
     #ifdef MESSAGE_PROBE_COORDINATES
     // All done! Output the probe position as message.
@@ -340,9 +529,11 @@ void mc_parking_motion (float *parking_target, plan_line_data_t *pl_data)
         return; // Block during abort.
 
     if (plan_buffer_line(parking_target, pl_data)) {
+        st_prep_lock();
         sys.step_control.execute_sys_motion = on;
         sys.step_control.end_motion = off; // Allow parking motion to execute, if feed hold is active.
         st_parking_setup_buffer(); // Setup step segment buffer for special parking motion case
+        st_prep_unlock();
         st_prep_buffer();
         st_wake_up();
         do {
@@ -350,7 +541,9 @@ void mc_parking_motion (float *parking_target, plan_line_data_t *pl_data)
             if (sys.abort)
                 return;
         } while (sys.step_control.execute_sys_motion);
+        st_prep_lock();
         st_parking_restore_buffer(); // Restore step segment buffer to normal run state.
+        st_prep_unlock();
     } else {
         sys.step_control.execute_sys_motion = off;
         protocol_exec_rt_system();
@@ -32,6 +32,22 @@
 #define HOMING_CYCLE_Y    bit(Y_AXIS)
 #define HOMING_CYCLE_Z    bit(Z_AXIS)
 
+#ifndef PARSE_QUEUE_SIZE
+  #define PARSE_QUEUE_SIZE 16
+#endif
+
+// Returns the memory required for a parse queue of the given number of lines
+uint32_t mc_queue_size(uint32_t lines);
+
+// Sets the parse queue to use, memory provided by the arena
+void mc_queue_init(void *buffer, uint32_t lines);
+
+// Discards all lines in the parse queue
+void mc_queue_reset();
+
+// Moves lines from the parse queue to the planner buffer while there is room
+void mc_queue_drain();
+
 
 // Execute linear motion in absolute millimeter coordinates. Feed rate given in millimeters/second
 // unless invert_feed_rate is true. Then the feed_rate means that the motion should be completed in
@@ -45,6 +61,10 @@ void mc_line(float *target, plan_line_data_t *pl_data);
 void mc_arc(float *target, plan_line_data_t *pl_data, float *position, float *offset, float radius,
   uint8_t axis_0, uint8_t axis_1, uint8_t axis_linear, bool is_clockwise_arc);
 
+// Execute canned drilling cycle G73, G81, G82 or G83 in the XY plane. position == current xyz,
+// canned holds the cycle parameters and hole positions in machine coordinates.
+void mc_canned_drill(motion_mode_t motion, float *position, gc_canned_t *canned, plan_line_data_t *pl_data);
+
 // Dwell for a specific number of seconds
 void mc_dwell(float seconds);
 
@@ -0,0 +1,464 @@
+/*
+  ngc_expr.c - g-code expression evaluator
+  Part of Grbl
+
+  Copyright (c) 2017 Terje Io
+
+  Grbl is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  Grbl is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with Grbl.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+/*
+  Evaluates NGC style bracketed expressions, as in LinuxCNC:
+
+    Binary operators, by precedence: ** | * / MOD | + - | EQ NE GT GE LT LE | AND OR XOR
+    Unary functions: ABS ACOS ASIN ATAN[y]/[x] COS EXP FIX FUP LN ROUND SIN SQRT TAN
+    Values: numbers, #<id>, #<name>, [expression] and functions, optionally signed.
+
+  Operators of equal precedence are evaluated left to right, angles are in degrees. Comparisons
+  and logical operators evaluate to 1.0 or 0.0, any non-zero value is true.
+
+  The evaluator does not allocate memory. Each bracket level uses a fixed size operand stack on the
+  C stack, one entry per precedence level, and nesting is limited to NGC_EXPR_MAX_DEPTH levels.
+*/
+
+#include "grbl.h"
+
+#define NGC_EXPR_STACK_SIZE 6           // Precedence levels + 1
+#define NGC_EXPR_EQUAL_TOLERANCE 0.0001f
+#define RAD_PER_DEG (M_PI / 180.0f)
+#define DEG_PER_RAD (180.0f / M_PI)
+
+typedef enum {
+    NGCBinaryOp_NoOp = 0,
+    NGCBinaryOp_RightBracket,
+    NGCBinaryOp_And,
+    NGCBinaryOp_Or,
+    NGCBinaryOp_Xor,
+    NGCBinaryOp_EQ,
+    NGCBinaryOp_NE,
+    NGCBinaryOp_GT,
+    NGCBinaryOp_GE,
+    NGCBinaryOp_LT,
+    NGCBinaryOp_LE,
+    NGCBinaryOp_Add,
+    NGCBinaryOp_Subtract,
+    NGCBinaryOp_Multiply,
+    NGCBinaryOp_Divide,
+    NGCBinaryOp_Modulo,
+    NGCBinaryOp_Power
+} ngc_binary_op_t;
+
+typedef enum {
+    NGCUnaryOp_Abs = 0,
+    NGCUnaryOp_Acos,
+    NGCUnaryOp_Asin,
+    NGCUnaryOp_Atan,
+    NGCUnaryOp_Cos,
+    NGCUnaryOp_Exp,
+    NGCUnaryOp_Fix,
+    NGCUnaryOp_Fup,
+    NGCUnaryOp_Ln,
+    NGCUnaryOp_Round,
+    NGCUnaryOp_Sin,
+    NGCUnaryOp_Sqrt,
+    NGCUnaryOp_Tan
+} ngc_unary_op_t;
+
+typedef struct {
+    const char *name;
+    uint8_t op;
+} ngc_op_name_t;
+
+// NOTE: No name may be a prefix of another, names are matched without delimiters.
+static const ngc_op_name_t binary_ops[] = {
+    { "AND", NGCBinaryOp_And },
+    { "OR",  NGCBinaryOp_Or },
+    { "XOR", NGCBinaryOp_Xor },
+    { "EQ",  NGCBinaryOp_EQ },
+    { "NE",  NGCBinaryOp_NE },
+    { "GT",  NGCBinaryOp_GT },
+    { "GE",  NGCBinaryOp_GE },
+    { "LT",  NGCBinaryOp_LT },
+    { "LE",  NGCBinaryOp_LE },
+    { "MOD", NGCBinaryOp_Modulo }
+};
+
+static const ngc_op_name_t unary_ops[] = {
+    { "ABS",   NGCUnaryOp_Abs },
+    { "ACOS",  NGCUnaryOp_Acos },
+    { "ASIN",  NGCUnaryOp_Asin },
+    { "ATAN",  NGCUnaryOp_Atan },
+    { "COS",   NGCUnaryOp_Cos },
+    { "EXP",   NGCUnaryOp_Exp },
+    { "FIX",   NGCUnaryOp_Fix },
+    { "FUP",   NGCUnaryOp_Fup },
+    { "LN",    NGCUnaryOp_Ln },
+    { "ROUND", NGCUnaryOp_Round },
+    { "SIN",   NGCUnaryOp_Sin },
+    { "SQRT",  NGCUnaryOp_Sqrt },
+    { "TAN",   NGCUnaryOp_Tan }
+};
+
+static CORE_STATE uint_fast8_t depth = 0; // Current nesting depth.
+
+// Matches the operator or function name at line[*pos], pos is advanced past it. Returns false if no match.
+static bool match_name (char *line, uint32_t *pos, const ngc_op_name_t *names, uint_fast8_t n_names, uint8_t *op)
+{
+    uint_fast8_t idx, len;
+
+    for (idx = 0; idx < n_names; idx++) {
+        len = strlen(names[idx].name);
+        if (!strncmp(&line[*pos], names[idx].name, len)) {
+            *op = names[idx].op;
+            *pos += len;
+            return true;
+        }
+    }
+
+    return false;
+}
+
+static uint_fast8_t precedence (ngc_binary_op_t op)
+{
+    switch (op) {
+
+        case NGCBinaryOp_RightBracket:
+            return 0;
+
+        case NGCBinaryOp_And:
+        case NGCBinaryOp_Or:
+        case NGCBinaryOp_Xor:
+            return 1;
+
+        case NGCBinaryOp_EQ:
+        case NGCBinaryOp_NE:
+        case NGCBinaryOp_GT:
+        case NGCBinaryOp_GE:
+        case NGCBinaryOp_LT:
+        case NGCBinaryOp_LE:
+            return 2;
+
+        case NGCBinaryOp_Add:
+        case NGCBinaryOp_Subtract:
+            return 3;
+
+        case NGCBinaryOp_Multiply:
+        case NGCBinaryOp_Divide:
+        case NGCBinaryOp_Modulo:
+            return 4;
+
+        default: // NGCBinaryOp_Power
+            return 5;
+    }
+}
+
+// Reads the binary operator or closing bracket following a value.
+static status_code_t read_operation (char *line, uint32_t *pos, ngc_binary_op_t *op)
+{
+    uint8_t named_op;
+
+    switch (line[*pos]) {
+
+        case ']':
+            *op = NGCBinaryOp_RightBracket;
+            break;
+
+        case '+':
+            *op = NGCBinaryOp_Add;
+            break;
+
+        case '-':
+            *op = NGCBinaryOp_Subtract;
+            break;
+
+        case '/':
+            *op = NGCBinaryOp_Divide;
+            break;
+
+        case '*':
+            if (line[*pos + 1] == '*') {
+                (*pos)++;
+                *op = NGCBinaryOp_Power;
+            } else
+                *op = NGCBinaryOp_Multiply;
+            break;
+
+        default:
+            if (!match_name(line, pos, binary_ops, sizeof(binary_ops) / sizeof(ngc_op_name_t), &named_op))
+                return line[*pos] == '\0' ? Status_ExpressionSyntaxError : Status_ExpressionUnknownOp;
+            *op = (ngc_binary_op_t)named_op;
+            return Status_OK;
+    }
+
+    (*pos)++;
+
+    return Status_OK;
+}
+
+static status_code_t execute_binary (float *lhs, ngc_binary_op_t op, float rhs)
+{
+    switch (op) {
+
+        case NGCBinaryOp_Divide:
+            if (rhs == 0.0f)
+                return Status_ExpressionDivideByZero;
+            *lhs /= rhs;
+            break;
+
+        case NGCBinaryOp_Modulo:
+            if (rhs == 0.0f)
+                return Status_ExpressionDivideByZero;
+            *lhs = fmodf(*lhs, rhs);
+            if (*lhs < 0.0f) // Result is never negative, as in LinuxCNC.
+                *lhs += fabsf(rhs);
+            break;
+
+        case NGCBinaryOp_Power:
+            if (*lhs < 0.0f && rhs != truncf(rhs))
+                return Status_ExpressionArgumentOutOfRange;
+            *lhs = powf(*lhs, rhs);
+            break;
+
+        case NGCBinaryOp_Multiply:
+            *lhs *= rhs;
+            break;
+
+        case NGCBinaryOp_Add:
+            *lhs += rhs;
+            break;
+
+        case NGCBinaryOp_Subtract:
+            *lhs -= rhs;
+            break;
+
+        case NGCBinaryOp_And:
+            *lhs = (*lhs != 0.0f && rhs != 0.0f) ? 1.0f : 0.0f;
+            break;
+
+        case NGCBinaryOp_Or:
+            *lhs = (*lhs != 0.0f || rhs != 0.0f) ? 1.0f : 0.0f;
+            break;
+
+        case NGCBinaryOp_Xor:
+            *lhs = ((*lhs != 0.0f) != (rhs != 0.0f)) ? 1.0f : 0.0f;
+            break;
+
+        case NGCBinaryOp_EQ:
+            *lhs = fabsf(*lhs - rhs) < NGC_EXPR_EQUAL_TOLERANCE ? 1.0f : 0.0f;
+            break;
+
+        case NGCBinaryOp_NE:
+            *lhs = fabsf(*lhs - rhs) >= NGC_EXPR_EQUAL_TOLERANCE ? 1.0f : 0.0f;
+            break;
+
+        case NGCBinaryOp_GT:
+            *lhs = *lhs > rhs ? 1.0f : 0.0f;
+            break;
+
+        case NGCBinaryOp_GE:
+            *lhs = *lhs >= rhs ? 1.0f : 0.0f;
+            break;
+
+        case NGCBinaryOp_LT:
+            *lhs = *lhs < rhs ? 1.0f : 0.0f;
+            break;
+
+        case NGCBinaryOp_LE:
+            *lhs = *lhs <= rhs ? 1.0f : 0.0f;
+            break;
+
+        default:
+            return Status_ExpressionUnknownOp;
+    }
+
+    return Status_OK;
+}
+
+// Reads a unary function and its bracketed argument, ATAN takes two: ATAN[y]/[x].
+static status_code_t read_unary (char *line, uint32_t *pos, float *value)
+{
+    uint8_t op;
+    float x;
+    status_code_t status;
+
+    if (!match_name(line, pos, unary_ops, sizeof(unary_ops) / sizeof(ngc_op_name_t), &op))
+        return Status_BadNumberFormat;
+
+    if ((status = ngc_eval_expression(line, pos, value)) != Status_OK)
+        return status;
+
+    switch ((ngc_unary_op_t)op) {
+
+        case NGCUnaryOp_Abs:
+            *value = fabsf(*value);
+            break;
+
+        case NGCUnaryOp_Acos:
+            if (*value < -1.0f || *value > 1.0f)
+                return Status_ExpressionArgumentOutOfRange;
+            *value = acosf(*value) * DEG_PER_RAD;
+            break;
+
+        case NGCUnaryOp_Asin:
+            if (*value < -1.0f || *value > 1.0f)
+                return Status_ExpressionArgumentOutOfRange;
+            *value = asinf(*value) * DEG_PER_RAD;
+            break;
+
+        case NGCUnaryOp_Atan:
+            if (line[(*pos)++] != '/')
+                return Status_ExpressionSyntaxError;
+            if ((status = ngc_eval_expression(line, pos, &x)) != Status_OK)
+                return status;
+            *value = atan2f(*value, x) * DEG_PER_RAD;
+            break;
+
+        case NGCUnaryOp_Cos:
+            *value = cosf(*value * RAD_PER_DEG);
+            break;
+
+        case NGCUnaryOp_Exp:
+            *value = expf(*value);
+            break;
+
+        case NGCUnaryOp_Fix:
+            *value = floorf(*value);
+            break;
+
+        case NGCUnaryOp_Fup:
+            *value = ceilf(*value);
+            break;
+
+        case NGCUnaryOp_Ln:
+            if (*value <= 0.0f)
+                return Status_ExpressionArgumentOutOfRange;
+            *value = logf(*value);
+            break;
+
+        case NGCUnaryOp_Round:
+            *value = roundf(*value);
+            break;
+
+        case NGCUnaryOp_Sin:
+            *value = sinf(*value * RAD_PER_DEG);
+            break;
+
+        case NGCUnaryOp_Sqrt:
+            if (*value < 0.0f)
+                return Status_ExpressionArgumentOutOfRange;
+            *value = sqrtf(*value);
+            break;
+
+        case NGCUnaryOp_Tan:
+            *value = tanf(*value * RAD_PER_DEG);
+            break;
+    }
+
+    return Status_OK;
+}
+
+// Reads a parameter reference, pos is the index following the '#'. The id may itself be a value: ##1, #[#1+1].
+static status_code_t read_parameter (char *line, uint32_t *pos, float *value)
+{
+    float id;
+    status_code_t status;
+
+    if (line[*pos] == '<')
+        return ngc_named_param_get(line, pos, value);
+
+    if (depth == NGC_EXPR_MAX_DEPTH)
+        return Status_ExpressionStackOverflow;
+
+    depth++;
+    status = ngc_read_real_value(line, pos, &id);
+    depth--;
+
+    return status == Status_OK ? ngc_param_get(id, value) : status;
+}
+
+status_code_t ngc_read_real_value (char *line, uint32_t *pos, float *value)
+{
+    char c = line[*pos];
+    bool negative = c == '-';
+    status_code_t status;
+
+    if (negative || c == '+')
+        c = line[++(*pos)];
+
+    if (c == '[')
+        status = ngc_eval_expression(line, pos, value);
+    else if (c == '#') {
+        (*pos)++;
+        status = read_parameter(line, pos, value);
+    } else if (c >= 'A' && c <= 'Z')
+        status = read_unary(line, pos, value);
+    else if (c != '-' && c != '+' && read_float(line, pos, value))
+        status = Status_OK;
+    else
+        status = Status_BadNumberFormat;
+
+    if (negative && status == Status_OK)
+        *value = -*value;
+
+    return status;
+}
+
+status_code_t ngc_eval_expression (char *line, uint32_t *pos, float *value)
+{
+    float values[NGC_EXPR_STACK_SIZE];
+    ngc_binary_op_t ops[NGC_EXPR_STACK_SIZE];
+    uint_fast8_t stack_idx = 1;
+    status_code_t status;
+
+    if (line[*pos] != '[')
+        return Status_ExpressionSyntaxError;
+
+    if (depth == NGC_EXPR_MAX_DEPTH)
+        return Status_ExpressionStackOverflow;
+
+    depth++;
+    (*pos)++;
+
+    if ((status = ngc_read_real_value(line, pos, &values[0])) == Status_OK)
+        status = read_operation(line, pos, &ops[0]);
+
+    // Operator precedence parsing: the stack only grows for operators of higher precedence than the one
+    // below, and is reduced as soon as an operator of lower or equal precedence is read. Stack usage is
+    // thus bounded by the number of precedence levels.
+    while (status == Status_OK && ops[0] != NGCBinaryOp_RightBracket) {
+
+        if ((status = ngc_read_real_value(line, pos, &values[stack_idx])) != Status_OK ||
+             (status = read_operation(line, pos, &ops[stack_idx])) != Status_OK)
+            break;
+
+        if (precedence(ops[stack_idx]) > precedence(ops[stack_idx - 1]))
+            stack_idx++;
+        else while (precedence(ops[stack_idx]) <= precedence(ops[stack_idx - 1])) {
+            if ((status = execute_binary(&values[stack_idx - 1], ops[stack_idx - 1], values[stack_idx])) != Status_OK)
+                break;
+            ops[stack_idx - 1] = ops[stack_idx];
+            if (stack_idx > 1 && precedence(ops[stack_idx - 1]) <= precedence(ops[stack_idx - 2]))
+                stack_idx--;
+            else
+                break;
+        }
+    }
+
+    depth--;
+
+    if (status == Status_OK)
+        *value = values[0];
+
+    return status;
+}
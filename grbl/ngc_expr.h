@@ -0,0 +1,36 @@
+/*
+  ngc_expr.h - g-code expression evaluator
+  Part of Grbl
+
+  Copyright (c) 2017 Terje Io
+
+  Grbl is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  Grbl is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with Grbl.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef ngc_expr_h
+#define ngc_expr_h
+
+// Max nesting depth of brackets, including function arguments and parameter references.
+#ifndef NGC_EXPR_MAX_DEPTH
+  #define NGC_EXPR_MAX_DEPTH 8
+#endif
+
+// Evaluates the bracketed expression at line[*pos], pos is advanced past the closing bracket.
+status_code_t ngc_eval_expression (char *line, uint32_t *pos, float *value);
+
+// Reads a number, parameter reference, bracketed expression or unary function, optionally signed,
+// at line[*pos]. pos is advanced past the value.
+status_code_t ngc_read_real_value (char *line, uint32_t *pos, float *value);
+
+#endif
@@ -0,0 +1,478 @@
+/*
+  ngc_flowctrl.c - O-word subroutines and loops executed from the program store
+  Part of Grbl
+
+  Copyright (c) 2017 Terje Io
+
+  Grbl is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  Grbl is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with Grbl.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+/*
+  Supports a subset of the LinuxCNC O-word flow control with numeric labels:
+
+    O<n> sub ... O<n> endsub, O<n> return, O<n> call [arg1] [arg2] ...
+    O<n> while [cond] ... O<n> endwhile
+    O<n> do ... O<n> while [cond]
+    O<n> repeat [count] ... O<n> endrepeat
+    O<n> break, O<n> continue
+
+  Lines of subroutine definitions and of loops are recorded in the program store, as filtered by
+  the protocol, instead of being executed. Each recorded line is acknowledged when stored. A loop
+  sent from the host is executed when its closing line is received and then discarded, subroutines
+  are kept until redefined or a reset. The line closing the loop or calling the subroutine is
+  acknowledged when execution completes, or with the status of the first line failing.
+  Conditions, counts and call arguments are expressions, call arguments are assigned to the global
+  parameters #1, #2, ... The program store is the part of the arena not used by other buffers.
+*/
+
+#include "grbl.h"
+
+#define NGC_NO_LINE 0xFFFFFFFF
+
+typedef enum {
+    NGCFlowCtrl_NoOp = 0,
+    NGCFlowCtrl_Sub,
+    NGCFlowCtrl_EndSub,
+    NGCFlowCtrl_Return,
+    NGCFlowCtrl_Call,
+    NGCFlowCtrl_Do,
+    NGCFlowCtrl_While,
+    NGCFlowCtrl_EndWhile,
+    NGCFlowCtrl_Repeat,
+    NGCFlowCtrl_EndRepeat,
+    NGCFlowCtrl_Break,
+    NGCFlowCtrl_Continue
+} ngc_cmd_t;
+
+typedef struct {
+    const char *keyword;
+    ngc_cmd_t cmd;
+} ngc_keyword_t;
+
+typedef struct {
+    uint32_t o_label;
+    uint32_t start;     // Offset of the first line of the subroutine body.
+    uint32_t end;       // Offset following the endsub line.
+} ngc_sub_t;
+
+typedef struct {
+    uint32_t o_label;
+    ngc_cmd_t cmd;      // NGCFlowCtrl_Call for subroutine calls, else the command opening the loop.
+    uint32_t pc;        // Return address for calls, loop start otherwise.
+    uint32_t repeats;   // Remaining repeats, NGCFlowCtrl_Repeat only.
+} ngc_frame_t;
+
+typedef struct {
+    bool active;
+    uint32_t o_label;
+    ngc_cmd_t cmd;      // Command opening the recorded subroutine or loop.
+    uint32_t start;     // Offset of the first recorded line.
+} ngc_recording_t;
+
+static const ngc_keyword_t keywords[] = {
+    { "SUB",       NGCFlowCtrl_Sub },
+    { "ENDSUB",    NGCFlowCtrl_EndSub },
+    { "RETURN",    NGCFlowCtrl_Return },
+    { "CALL",      NGCFlowCtrl_Call },
+    { "DO",        NGCFlowCtrl_Do },
+    { "WHILE",     NGCFlowCtrl_While },
+    { "ENDWHILE",  NGCFlowCtrl_EndWhile },
+    { "REPEAT",    NGCFlowCtrl_Repeat },
+    { "ENDREPEAT", NGCFlowCtrl_EndRepeat },
+    { "BREAK",     NGCFlowCtrl_Break },
+    { "CONTINUE",  NGCFlowCtrl_Continue }
+};
+
+static CORE_STATE char *store = NULL;
+static CORE_STATE uint32_t store_size = 0, store_used = 0;
+static CORE_STATE uint_fast8_t n_subs = 0;
+static CORE_STATE int_fast8_t stack_idx = -1;
+static CORE_STATE ngc_sub_t subs[NGC_MAX_SUBROUTINES];
+static CORE_STATE ngc_frame_t stack[NGC_STACK_DEPTH];
+static CORE_STATE ngc_recording_t recording;
+
+void ngc_flowctrl_init (char *buffer, uint32_t size)
+{
+    store = buffer;
+    store_size = size;
+    store_used = 0;
+    n_subs = 0;
+    stack_idx = -1;
+    recording.active = false;
+}
+
+bool ngc_flowctrl_recording ()
+{
+    return recording.active;
+}
+
+// Parses the O<label><keyword> start of the line, pos is set to the character following the keyword.
+static status_code_t parse_oword (char *line, uint32_t *o_label, ngc_cmd_t *cmd, uint32_t *pos)
+{
+    char keyword[10];
+    uint32_t idx = 1, len = 0, label = 0;
+
+    if (line[0] != 'O' || line[1] < '0' || line[1] > '9')
+        return Status_FlowControlSyntaxError;
+
+    while (line[idx] >= '0' && line[idx] <= '9')
+        label = label * 10 + (line[idx++] - '0');
+
+    while (line[idx] >= 'A' && line[idx] <= 'Z' && len < sizeof(keyword) - 1)
+        keyword[len++] = line[idx++];
+    keyword[len] = '\0';
+
+    *cmd = NGCFlowCtrl_NoOp;
+    for (len = 0; len < sizeof(keywords) / sizeof(ngc_keyword_t); len++) {
+        if (!strcmp(keyword, keywords[len].keyword)) {
+            *cmd = keywords[len].cmd;
+            break;
+        }
+    }
+
+    *o_label = label;
+    *pos = idx;
+
+    return *cmd == NGCFlowCtrl_NoOp ? Status_FlowControlSyntaxError : Status_OK;
+}
+
+// Evaluates the bracketed condition or count following the keyword, it must end the line.
+static status_code_t eval_argument (char *line, uint32_t *pos, float *value)
+{
+    status_code_t status;
+
+    if (line[*pos] != '[')
+        return Status_FlowControlSyntaxError;
+
+    if ((status = ngc_eval_expression(line, pos, value)) != Status_OK)
+        return status;
+
+    return line[*pos] == '\0' ? Status_OK : Status_FlowControlSyntaxError;
+}
+
+// Evaluates the bracketed call arguments to parameters #1, #2, ...
+static status_code_t call_arguments (char *line, uint32_t pos)
+{
+    float value;
+    uint32_t id = 1;
+    status_code_t status = Status_OK;
+
+    while (status == Status_OK && line[pos] != '\0') {
+        if (line[pos] != '[')
+            status = Status_FlowControlSyntaxError;
+        else if ((status = ngc_eval_expression(line, &pos, &value)) == Status_OK)
+            status = ngc_param_set(id++, value);
+    }
+
+    return status;
+}
+
+// Returns the command closing a subroutine or loop opened by cmd.
+static ngc_cmd_t closing_cmd (ngc_cmd_t cmd)
+{
+    switch (cmd) {
+
+        case NGCFlowCtrl_Sub:
+            return NGCFlowCtrl_EndSub;
+
+        case NGCFlowCtrl_Do:
+            return NGCFlowCtrl_While;
+
+        case NGCFlowCtrl_While:
+            return NGCFlowCtrl_EndWhile;
+
+        case NGCFlowCtrl_Repeat:
+            return NGCFlowCtrl_EndRepeat;
+
+        default:
+            return NGCFlowCtrl_NoOp;
+    }
+}
+
+// Returns the offset of the line closing the loop opened by cmd, searching from pc. NGC_NO_LINE if not found.
+static uint32_t find_closing (uint32_t pc, uint32_t o_label, ngc_cmd_t cmd)
+{
+    uint32_t label, pos;
+    ngc_cmd_t line_cmd, end_cmd = closing_cmd(cmd);
+
+    while (pc < store_used) {
+        if (parse_oword(&store[pc], &label, &line_cmd, &pos) == Status_OK && label == o_label && line_cmd == end_cmd)
+            return pc;
+        pc += strlen(&store[pc]) + 1;
+    }
+
+    return NGC_NO_LINE;
+}
+
+static ngc_sub_t *find_sub (uint32_t o_label)
+{
+    uint_fast8_t idx = n_subs;
+
+    while (idx--) {
+        if (subs[idx].o_label == o_label)
+            return &subs[idx];
+    }
+
+    return NULL;
+}
+
+// Removes a subroutine and its lines from the store. Only called when not recording.
+static void delete_sub (uint32_t o_label)
+{
+    ngc_sub_t *sub;
+
+    if ((sub = find_sub(o_label))) {
+
+        uint_fast8_t idx;
+        uint32_t start = sub->start, length = sub->end - sub->start;
+
+        memmove(&store[start], &store[sub->end], store_used - sub->end);
+        store_used -= length;
+
+        memmove(sub, sub + 1, (&subs[--n_subs] - sub) * sizeof(ngc_sub_t));
+
+        idx = n_subs;
+        while (idx--) {
+            if (subs[idx].start > start) {
+                subs[idx].start -= length;
+                subs[idx].end -= length;
+            }
+        }
+    }
+}
+
+static status_code_t push (uint32_t o_label, ngc_cmd_t cmd, uint32_t pc, uint32_t repeats)
+{
+    if (stack_idx == NGC_STACK_DEPTH - 1)
+        return Status_FlowControlStackOverflow;
+
+    stack_idx++;
+    stack[stack_idx].o_label = o_label;
+    stack[stack_idx].cmd = cmd;
+    stack[stack_idx].pc = pc;
+    stack[stack_idx].repeats = repeats;
+
+    return Status_OK;
+}
+
+// Returns true if the innermost subroutine call or loop has the given label and was opened by cmd,
+// any loop if cmd is NGCFlowCtrl_NoOp.
+static bool is_current (uint32_t o_label, ngc_cmd_t cmd)
+{
+    return stack_idx >= 0 && stack[stack_idx].o_label == o_label &&
+            (cmd == NGCFlowCtrl_NoOp ? stack[stack_idx].cmd != NGCFlowCtrl_Call : stack[stack_idx].cmd == cmd);
+}
+
+// Executes lines from the store starting at pc until pc reaches end or a line fails.
+static status_code_t execute (uint32_t pc, uint32_t end)
+{
+    char *line;
+    float value;
+    uint32_t o_label, pos, next;
+    ngc_cmd_t cmd;
+    ngc_sub_t *sub;
+    status_code_t status = Status_OK;
+
+    while (status == Status_OK && pc != end) {
+
+        if (pc >= store_used) {
+            status = Status_FlowControlSyntaxError; // Subroutine or loop not closed.
+            break;
+        }
+
+        line = &store[pc];
+        next = pc + strlen(line) + 1;
+
+        if (line[0] != 'O')
+            status = gc_execute_line(line);
+
+        else if ((status = parse_oword(line, &o_label, &cmd, &pos)) == Status_OK) switch (cmd) {
+
+            case NGCFlowCtrl_Call:
+                if ((sub = find_sub(o_label)) == NULL)
+                    status = Status_FlowControlSyntaxError;
+                else if ((status = call_arguments(line, pos)) == Status_OK &&
+                          (status = push(o_label, NGCFlowCtrl_Call, next, 0)) == Status_OK)
+                    next = sub->start;
+                break;
+
+            case NGCFlowCtrl_EndSub:
+            case NGCFlowCtrl_Return:
+                // Unwind loops open in the subroutine.
+                while (stack_idx >= 0 && stack[stack_idx].cmd != NGCFlowCtrl_Call)
+                    stack_idx--;
+                if (line[pos] != '\0' || !is_current(o_label, NGCFlowCtrl_Call))
+                    status = Status_FlowControlSyntaxError;
+                else
+                    next = stack[stack_idx--].pc;
+                break;
+
+            case NGCFlowCtrl_Do:
+                status = line[pos] != '\0' ? Status_FlowControlSyntaxError : push(o_label, NGCFlowCtrl_Do, next, 0);
+                break;
+
+            case NGCFlowCtrl_While:
+                if ((status = eval_argument(line, &pos, &value)) != Status_OK)
+                    break;
+                if (is_current(o_label, NGCFlowCtrl_Do)) { // End of do loop.
+                    if (value != 0.0f)
+                        next = stack[stack_idx].pc;
+                    else
+                        stack_idx--;
+                } else if (value != 0.0f)
+                    status = push(o_label, NGCFlowCtrl_While, pc, 0);
+                else if ((next = find_closing(next, o_label, NGCFlowCtrl_While)) == NGC_NO_LINE)
+                    status = Status_FlowControlSyntaxError;
+                else
+                    next += strlen(&store[next]) + 1;
+                break;
+
+            case NGCFlowCtrl_EndWhile:
+                if (line[pos] != '\0' || !is_current(o_label, NGCFlowCtrl_While))
+                    status = Status_FlowControlSyntaxError;
+                else
+                    next = stack[stack_idx--].pc; // Back to while line for evaluation.
+                break;
+
+            case NGCFlowCtrl_Repeat:
+                if ((status = eval_argument(line, &pos, &value)) != Status_OK)
+                    break;
+                if (value >= 1.0f)
+                    status = push(o_label, NGCFlowCtrl_Repeat, next, (uint32_t)truncf(value));
+                else if ((next = find_closing(next, o_label, NGCFlowCtrl_Repeat)) == NGC_NO_LINE)
+                    status = Status_FlowControlSyntaxError;
+                else
+                    next += strlen(&store[next]) + 1;
+                break;
+
+            case NGCFlowCtrl_EndRepeat:
+                if (line[pos] != '\0' || !is_current(o_label, NGCFlowCtrl_Repeat))
+                    status = Status_FlowControlSyntaxError;
+                else if (--stack[stack_idx].repeats)
+                    next = stack[stack_idx].pc;
+                else
+                    stack_idx--;
+                break;
+
+            case NGCFlowCtrl_Break:
+            case NGCFlowCtrl_Continue:
+                // Continue executes the closing line of the loop, break skips past it.
+                if (line[pos] != '\0' || !is_current(o_label, NGCFlowCtrl_NoOp) ||
+                     (next = find_closing(next, o_label, stack[stack_idx].cmd)) == NGC_NO_LINE)
+                    status = Status_FlowControlSyntaxError;
+                else if (cmd == NGCFlowCtrl_Break) {
+                    next += strlen(&store[next]) + 1;
+                    stack_idx--;
+                }
+                break;
+
+            default: // Subroutines can not be defined in subroutines or loops.
+                status = Status_FlowControlSyntaxError;
+                break;
+        }
+
+        if (!protocol_execute_realtime()) // Runtime command check point.
+            break;                        // Bail on system abort.
+
+        pc = next;
+    }
+
+    stack_idx = -1;
+
+    return status;
+}
+
+status_code_t ngc_flowctrl (char *line)
+{
+    status_code_t status = Status_OK;
+    uint32_t o_label = 0, pos = 0, length = strlen(line) + 1;
+    ngc_cmd_t cmd = NGCFlowCtrl_NoOp;
+    ngc_sub_t *sub;
+
+    if (line[0] == 'O' && (status = parse_oword(line, &o_label, &cmd, &pos)) != Status_OK)
+        return status;
+
+    if (recording.active) {
+
+        if (cmd == NGCFlowCtrl_Sub)
+            return Status_FlowControlSyntaxError; // Subroutines can not be defined in subroutines or loops.
+
+        if (line[0] == GC_BINARY_BLOCK_PREFIX)
+            return Status_FlowControlSyntaxError; // Binary blocks are delta coded and can not be replayed.
+
+        if (store_used + length > store_size) {
+            store_used = recording.start; // Discard recorded lines.
+            recording.active = false;
+            return Status_FlowControlOutOfMemory;
+        }
+
+        memcpy(&store[store_used], line, length);
+        store_used += length;
+
+        if (o_label == recording.o_label && cmd == closing_cmd(recording.cmd)) {
+
+            recording.active = false;
+
+            if (recording.cmd == NGCFlowCtrl_Sub) {
+                subs[n_subs].o_label = o_label;
+                subs[n_subs].start = recording.start;
+                subs[n_subs++].end = store_used;
+            } else {
+                status = execute(recording.start, store_used);
+                store_used = recording.start; // Discard loop.
+            }
+        }
+
+        return status;
+    }
+
+    switch (cmd) {
+
+        case NGCFlowCtrl_Sub:
+            if (line[pos] != '\0')
+                return Status_FlowControlSyntaxError;
+            delete_sub(o_label);
+            if (n_subs == NGC_MAX_SUBROUTINES)
+                return Status_FlowControlOutOfMemory;
+            recording.start = store_used; // Sub line is not stored.
+            break;
+
+        case NGCFlowCtrl_Do:
+        case NGCFlowCtrl_While:
+        case NGCFlowCtrl_Repeat:
+            if (store_used + length > store_size)
+                return Status_FlowControlOutOfMemory;
+            recording.start = store_used;
+            memcpy(&store[store_used], line, length);
+            store_used += length;
+            break;
+
+        case NGCFlowCtrl_Call:
+            if ((sub = find_sub(o_label)) == NULL)
+                return Status_FlowControlSyntaxError;
+            if ((status = call_arguments(line, pos)) != Status_OK)
+                return status;
+            push(o_label, NGCFlowCtrl_Call, NGC_NO_LINE, 0);
+            return execute(sub->start, NGC_NO_LINE);
+
+        default: // Closing or loop control line without open subroutine or loop.
+            return Status_FlowControlSyntaxError;
+    }
+
+    recording.active = true;
+    recording.o_label = o_label;
+    recording.cmd = cmd;
+
+    return Status_OK;
+}
@@ -0,0 +1,44 @@
+/*
+  ngc_flowctrl.h - O-word subroutines and loops executed from the program store
+  Part of Grbl
+
+  Copyright (c) 2017 Terje Io
+
+  Grbl is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  Grbl is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with Grbl.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef ngc_flowctrl_h
+#define ngc_flowctrl_h
+
+// Max number of subroutines defined at the same time.
+#ifndef NGC_MAX_SUBROUTINES
+  #define NGC_MAX_SUBROUTINES 16
+#endif
+
+// Max nesting depth of subroutine calls and loops.
+#ifndef NGC_STACK_DEPTH
+  #define NGC_STACK_DEPTH 10
+#endif
+
+// Sets the program store, called by the arena on startup and reset. Clears all subroutines.
+void ngc_flowctrl_init (char *buffer, uint32_t size);
+
+// Returns true if lines are being recorded to the program store, a subroutine or loop is open.
+bool ngc_flowctrl_recording (void);
+
+// Executes an O-word line or records a line to the program store when recording.
+// Streamed loops are executed when closed, subroutines when called.
+status_code_t ngc_flowctrl (char *line);
+
+#endif
@@ -0,0 +1,206 @@
+/*
+  ngc_params.c - numbered and named g-code parameters
+  Part of Grbl
+
+  Copyright (c) 2017 Terje Io
+
+  Grbl is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  Grbl is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with Grbl.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+/*
+  Numbered parameters #1 to #NGC_NUMBERED_PARAMETERS are user parameters, zero until assigned.
+  Named parameters, #<name>, are created on first assignment and are undefined until then.
+  All parameters are global, also subroutine call arguments #1, #2, ..., and are kept until
+  power down. The read-only system parameters follow LinuxCNC numbering:
+
+    #5220       Active coordinate system, 1 to 6 for G54 to G59.
+    #5420-#542x Current position of axis X, Y, Z, (A, B, C) in the active coordinate system
+                and program units.
+*/
+
+#include "grbl.h"
+
+#define NGC_PARAM_COORD_SYSTEM 5220
+#define NGC_PARAM_POSITION     5420
+
+typedef struct {
+    char name[NGC_PARAMETER_NAME_LENGTH + 1];
+    bool defined;
+    float value;
+} ngc_named_param_t;
+
+typedef struct {
+    uint32_t id;    // Numbered parameter id, or index of the named parameter if named.
+    bool named;
+    float value;
+} ngc_assignment_t;
+
+static CORE_STATE float params[NGC_NUMBERED_PARAMETERS];
+static CORE_STATE ngc_named_param_t named_params[NGC_NAMED_PARAMETERS];
+static CORE_STATE ngc_assignment_t assignments[NGC_MAX_ASSIGNMENTS];
+static CORE_STATE uint_fast8_t n_assignments = 0;
+
+status_code_t ngc_param_get (float id, float *value)
+{
+    uint32_t idx = (uint32_t)id;
+
+    if (id < 1.0f || id != (float)idx)
+        return Status_ParameterInvalid;
+
+    if (idx <= NGC_NUMBERED_PARAMETERS)
+        *value = params[idx - 1];
+
+    else if (idx == NGC_PARAM_COORD_SYSTEM)
+        *value = (float)(gc_state.modal.coord_select + 1);
+
+    else if (idx >= NGC_PARAM_POSITION && idx < NGC_PARAM_POSITION + N_AXIS) {
+        idx -= NGC_PARAM_POSITION;
+        // WPos = MPos - WCS - G92 - TLO
+        *value = gc_state.position[idx] - gc_state.coord_system[idx] - gc_state.coord_offset[idx];
+        if (idx == TOOL_LENGTH_OFFSET_AXIS)
+            *value -= gc_state.tool_length_offset;
+        if (gc_state.modal.units == UnitsMode_Inches)
+            *value /= MM_PER_INCH;
+
+    } else
+        return Status_ParameterInvalid;
+
+    return Status_OK;
+}
+
+status_code_t ngc_param_set (uint32_t id, float value)
+{
+    if (id < 1 || id > NGC_NUMBERED_PARAMETERS)
+        return Status_ParameterInvalid; // Not a user parameter.
+
+    params[id - 1] = value;
+
+    return Status_OK;
+}
+
+// Reads the <name> at line[*pos] to name, returns false if invalid or too long.
+static bool read_name (char *line, uint32_t *pos, char *name)
+{
+    uint32_t len = 0;
+
+    if (line[*pos] != '<')
+        return false;
+
+    (*pos)++;
+    while (line[*pos] != '>') {
+        if (line[*pos] == '\0' || len == NGC_PARAMETER_NAME_LENGTH)
+            return false;
+        name[len++] = line[(*pos)++];
+    }
+    name[len] = '\0';
+    (*pos)++;
+
+    return len > 0;
+}
+
+// Returns the index of the named parameter, -1 if not found.
+static int_fast8_t find_named_param (char *name)
+{
+    int_fast8_t idx = NGC_NAMED_PARAMETERS;
+
+    while (idx--) {
+        if (named_params[idx].name[0] != '\0' && !strcmp(named_params[idx].name, name))
+            break;
+    }
+
+    return idx;
+}
+
+status_code_t ngc_named_param_get (char *line, uint32_t *pos, float *value)
+{
+    int_fast8_t idx;
+    char name[NGC_PARAMETER_NAME_LENGTH + 1];
+
+    if (!read_name(line, pos, name))
+        return Status_ExpressionSyntaxError;
+
+    if ((idx = find_named_param(name)) < 0 || !named_params[idx].defined)
+        return Status_ParameterInvalid; // Undefined.
+
+    *value = named_params[idx].value;
+
+    return Status_OK;
+}
+
+status_code_t ngc_param_assign (char *line, uint32_t *pos)
+{
+    float id;
+    int_fast8_t idx;
+    status_code_t status;
+    ngc_assignment_t *assignment = &assignments[n_assignments];
+    char name[NGC_PARAMETER_NAME_LENGTH + 1];
+
+    if (n_assignments == NGC_MAX_ASSIGNMENTS)
+        return Status_ExpressionStackOverflow;
+
+    if ((assignment->named = line[*pos] == '<')) {
+
+        if (!read_name(line, pos, name))
+            return Status_ExpressionSyntaxError;
+
+        // Create the parameter, undefined until the assignment is committed.
+        if ((idx = find_named_param(name)) < 0) {
+            idx = NGC_NAMED_PARAMETERS;
+            while (idx-- && named_params[idx].name[0] != '\0');
+            if (idx < 0)
+                return Status_ParameterInvalid; // No free slot.
+            strcpy(named_params[idx].name, name);
+            named_params[idx].defined = false;
+        }
+        assignment->id = (uint32_t)idx;
+
+    } else {
+
+        if ((status = ngc_read_real_value(line, pos, &id)) != Status_OK)
+            return status;
+
+        if (id < 1.0f || id > (float)NGC_NUMBERED_PARAMETERS || id != truncf(id))
+            return Status_ParameterInvalid; // Not a user parameter.
+
+        assignment->id = (uint32_t)id;
+    }
+
+    if (line[(*pos)++] != '=')
+        return Status_ExpressionSyntaxError;
+
+    if ((status = ngc_read_real_value(line, pos, &assignment->value)) == Status_OK)
+        n_assignments++;
+
+    return status;
+}
+
+void ngc_params_commit ()
+{
+    ngc_assignment_t *assignment = assignments;
+
+    while (n_assignments) {
+        if (assignment->named) {
+            named_params[assignment->id].value = assignment->value;
+            named_params[assignment->id].defined = true;
+        } else
+            params[assignment->id - 1] = assignment->value;
+        assignment++;
+        n_assignments--;
+    }
+}
+
+void ngc_params_discard ()
+{
+    n_assignments = 0;
+}
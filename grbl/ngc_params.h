@@ -0,0 +1,62 @@
+/*
+  ngc_params.h - numbered and named g-code parameters
+  Part of Grbl
+
+  Copyright (c) 2017 Terje Io
+
+  Grbl is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  Grbl is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with Grbl.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef ngc_params_h
+#define ngc_params_h
+
+// Number of user numbered parameters, #1 to #NGC_NUMBERED_PARAMETERS.
+#ifndef NGC_NUMBERED_PARAMETERS
+  #define NGC_NUMBERED_PARAMETERS 100
+#endif
+
+// Max number of named parameters and max length of their names.
+#ifndef NGC_NAMED_PARAMETERS
+  #define NGC_NAMED_PARAMETERS 16
+#endif
+#ifndef NGC_PARAMETER_NAME_LENGTH
+  #define NGC_PARAMETER_NAME_LENGTH 15
+#endif
+
+// Max number of parameter assignments in a block.
+#ifndef NGC_MAX_ASSIGNMENTS
+  #define NGC_MAX_ASSIGNMENTS 8
+#endif
+
+// Reads the value of numbered parameter id, including the read-only system parameters.
+status_code_t ngc_param_get (float id, float *value);
+
+// Sets numbered parameter id immediately. Used for subroutine call arguments.
+status_code_t ngc_param_set (uint32_t id, float value);
+
+// Reads the value of the named parameter in line, pos is the index of the '<' and is advanced past '>'.
+status_code_t ngc_named_param_get (char *line, uint32_t *pos, float *value);
+
+// Parses an assignment, #<id>=<value> or #<name>=<value>, pos is the index following the '#'.
+// The assignment is deferred until ngc_params_commit(), parameters referenced in the same block
+// thus all read their old values.
+status_code_t ngc_param_assign (char *line, uint32_t *pos);
+
+// Performs the deferred assignments of the block, called when it is executed.
+void ngc_params_commit (void);
+
+// Discards the deferred assignments, called before a block is parsed.
+void ngc_params_discard (void);
+
+#endif
@@ -70,6 +70,20 @@ bool read_float (char *line, uint32_t *char_counter, float *float_ptr)
     if (!ndigit)
         return(false);
 
+    float fval = decimal_to_float(intval, exp);
+
+    // Assign floating point value with correct sign.
+    *float_ptr = isnegative ? - fval : fval;
+    *char_counter = ptr - line - 1; // Set char_counter to next statement
+
+    return true;
+}
+
+
+// Converts the decimal number intval * 10^exp to floating point. Also used by the binary block
+// decoder so values are identical to those of read_float().
+float decimal_to_float (uint32_t intval, int32_t exp)
+{
     // Convert integer into floating point.
     float fval = (float)intval;
 
@@ -87,11 +101,7 @@ bool read_float (char *line, uint32_t *char_counter, float *float_ptr)
         } while (--exp > 0);
     }
 
-    // Assign floating point value with correct sign.
-    *float_ptr = isnegative ? - fval : fval;
-    *char_counter = ptr - line - 1; // Set char_counter to next statement
-
-    return true;
+    return fval;
 }
 
 
@@ -162,3 +172,17 @@ uint8_t calc_checksum (uint8_t *data, uint32_t size) {
     return checksum;
 }
 
+// calculate CRC-16/CCITT (polynomial 0x1021, initial value 0xFFFF) for binary frames
+uint16_t calc_crc16 (uint8_t *data, uint32_t size) {
+
+    uint16_t crc = 0xFFFF;
+    uint_fast8_t bit;
+
+    while(size--) {
+        crc ^= (uint16_t)*(data++) << 8;
+        for(bit = 0; bit < 8; bit++)
+            crc = crc & 0x8000 ? (crc << 1) ^ 0x1021 : crc << 1;
+    }
+
+    return crc;
+}
@@ -116,11 +116,38 @@ typedef enum {
 #define bit_istrue(x,mask) ((x & mask) != 0)
 #define bit_isfalse(x,mask) ((x & mask) == 0)
 
+// Ring buffer index type and accessors for single producer, single consumer queues. The producer
+// owns the head index and the consumer the tail index. An index is published with release ordering
+// after the buffer slot it covers has been written or read, and the other side loads it with acquire
+// ordering before accessing the slot. Loads of an index by its owner may be relaxed.
+#ifdef USE_C11_ATOMICS
+#include <stdatomic.h>
+typedef atomic_uint_fast32_t ring_index_t;
+#define ring_index_load(idx) atomic_load_explicit(&(idx), memory_order_acquire)
+#define ring_index_load_own(idx) atomic_load_explicit(&(idx), memory_order_relaxed)
+#define ring_index_store(idx, value) atomic_store_explicit(&(idx), (value), memory_order_release)
+#else
+typedef volatile uint32_t ring_index_t;
+#define ring_index_load(idx) (idx)
+#define ring_index_load_own(idx) (idx)
+#define ring_index_store(idx, value) (idx) = (value)
+#endif
+
+// Storage class of the core state, thread-local when each thread is a controller instance.
+#ifdef CORE_INSTANCE_PER_THREAD
+#define CORE_STATE _Thread_local
+#else
+#define CORE_STATE
+#endif
+
 // Read a floating point value from a string. Line points to the input buffer, char_counter
 // is the indexer pointing to the current character of the line, while float_ptr is
 // a pointer to the result variable. Returns true when it succeeds
 bool read_float(char *line, uint32_t *char_counter, float *float_ptr);
 
+// Converts the decimal number intval * 10^exp to floating point, as read_float() does.
+float decimal_to_float(uint32_t intval, int32_t exp);
+
 // Non-blocking delay function used for general operation and suspend features.
 void delay_sec(float seconds, delaymode_t mode);
 
@@ -130,4 +157,7 @@ float limit_value_by_axis_maximum(float *max_value, float *unit_vec);
 // calculate checksum byte for EEPROM data
 uint8_t calc_checksum (uint8_t *data, uint32_t size);
 
+// calculate CRC-16/CCITT (polynomial 0x1021, initial value 0xFFFF) for binary frames
+uint16_t calc_crc16 (uint8_t *data, uint32_t size);
+
 #endif
@@ -23,8 +23,8 @@
 
 #include "grbl.h"
 
-static uint8_t feed_buf[FEED_OVR_BUFSIZE], accessory_buf[FEED_OVR_BUFSIZE];
-static volatile uint32_t feed_head = 0, feed_tail = 0, accessory_head = 0, accessory_tail = 0;
+static CORE_STATE uint8_t feed_buf[FEED_OVR_BUFSIZE], accessory_buf[FEED_OVR_BUFSIZE];
+static CORE_STATE volatile uint32_t feed_head = 0, feed_tail = 0, accessory_head = 0, accessory_tail = 0;
 
 void enqueue_feed_ovr (uint8_t cmd) {
 
@@ -23,11 +23,12 @@
 #include "grbl.h"
 
 
-static plan_block_t block_buffer[BLOCK_BUFFER_SIZE];  // A ring buffer for motion instructions
-static uint32_t block_buffer_tail;     // Index of the block to process now
-static uint32_t block_buffer_head;     // Index of the next block to be pushed
-static uint32_t next_buffer_head;      // Index of the next buffer head
-static uint32_t block_buffer_planned;  // Index of the optimally planned block
+static CORE_STATE plan_block_t *block_buffer;     // A ring buffer for motion instructions, carved from the arena
+static CORE_STATE uint32_t block_buffer_size;     // Number of blocks in the ring buffer
+static CORE_STATE ring_index_t block_buffer_tail; // Index of the block to process now, owned by the consumer (segment prep)
+static CORE_STATE ring_index_t block_buffer_head; // Index of the next block to be pushed, owned by the producer (planner)
+static CORE_STATE uint32_t next_buffer_head;      // Index of the next buffer head
+static CORE_STATE uint32_t block_buffer_planned;  // Index of the optimally planned block
 
 // Define planner variables
 typedef struct {
@@ -38,20 +39,20 @@ typedef struct {
   float previous_nominal_speed;  // Nominal speed of previous path line segment
 } planner_t;
 
-static planner_t pl;
+static CORE_STATE planner_t pl;
 
 
-// Returns the index of the next block in the ring buffer. Also called by stepper segment buffer.
-inline uint32_t plan_next_block_index (uint32_t block_index)
+// Returns the index of the next block in the ring buffer
+inline static uint32_t plan_next_block_index (uint32_t block_index)
 {
-    return block_index == (BLOCK_BUFFER_SIZE - 1) ? 0 : block_index + 1;
+    return block_index == (block_buffer_size - 1) ? 0 : block_index + 1;
 }
 
 
 // Returns the index of the previous block in the ring buffer
 inline static uint32_t plan_prev_block_index (uint32_t block_index)
 {
-    return block_index == 0 ? (BLOCK_BUFFER_SIZE - 1) : block_index - 1;
+    return block_index == 0 ? (block_buffer_size - 1) : block_index - 1;
 }
 
 
@@ -71,7 +72,8 @@ inline static uint32_t plan_prev_block_index (uint32_t block_index)
          neighboring blocks.
       b. A block entry speed cannot exceed one reverse-computed from its exit speed (next->entry_speed)
          with a maximum allowable deceleration over the block travel distance.
-      c. The last (or newest appended) block is planned from a complete stop (an exit speed of zero).
+      c. The last (or newest appended) block is planned from a complete stop (an exit speed of zero),
+         or from its host computed exit speed hint if provided. See plan_compute_exit_speed_sqr().
     2. Go over every block in chronological (forward) order and dial down junction speed values if
       a. The exit speed exceeds the one forward-computed from its entry speed with the maximum allowable
          acceleration over the block travel distance.
@@ -120,6 +122,31 @@ inline static uint32_t plan_prev_block_index (uint32_t block_index)
   look-ahead blocks numbering up to a hundred or more.
 
 */
+#ifdef PLANNER_EXIT_SPEED_HINTS
+
+// Returns the exit speed of the last block in the buffer: zero, a complete stop, unless the host has
+// computed the exit speed over the whole program. The hint is computed for programmed rates and is thus
+// scaled down by feed and rapid overrides below 100%, and it is limited by the nominal speed of the block.
+static float plan_compute_exit_speed_sqr (plan_block_t *block)
+{
+    float exit_speed_sqr = block->exit_speed_hint_sqr;
+
+    if (exit_speed_sqr > 0.0f) {
+
+        uint8_t override = min(sys.f_override, sys.r_override);
+        if (override < DEFAULT_FEED_OVERRIDE)
+            exit_speed_sqr *= (0.01f * override) * (0.01f * override);
+
+        float nominal_speed = plan_compute_profile_nominal_speed(block);
+        if (exit_speed_sqr > nominal_speed * nominal_speed)
+            exit_speed_sqr = nominal_speed * nominal_speed;
+    }
+
+    return exit_speed_sqr;
+}
+
+#endif
+
 static void planner_recalculate ()
 {
     // Initialize block index to the last block in the planner buffer.
@@ -136,8 +163,14 @@ static void planner_recalculate ()
     plan_block_t *next;
     plan_block_t *current = &block_buffer[block_index];
 
+  #ifdef PLANNER_EXIT_SPEED_HINTS
+    // Calculate maximum entry speed for last block in buffer, where the exit speed is zero or the hint.
+    entry_speed_sqr = plan_compute_exit_speed_sqr(current) + 2.0f * current->acceleration * current->millimeters;
+    current->entry_speed_sqr = min(current->max_entry_speed_sqr, entry_speed_sqr);
+  #else
     // Calculate maximum entry speed for last block in buffer, where the exit speed is always zero.
     current->entry_speed_sqr = min(current->max_entry_speed_sqr, 2.0f * current->acceleration * current->millimeters);
+  #endif
 
     block_index = plan_prev_block_index(block_index);
     if (block_index == block_buffer_planned) { // Only two plannable blocks in buffer. Reverse pass complete.
@@ -204,6 +237,21 @@ inline static void plan_reset_buffer()
 }
 
 
+// Returns the memory required for a block buffer of the given size. Called by the arena.
+uint32_t plan_buffer_size (uint32_t blocks)
+{
+    return blocks * sizeof(plan_block_t);
+}
+
+
+// Sets the block buffer, called by the arena on startup and reset before plan_reset().
+void plan_buffer_init (void *buffer, uint32_t blocks)
+{
+    block_buffer = (plan_block_t *)buffer;
+    block_buffer_size = blocks;
+}
+
+
 void plan_reset ()
 {
     memset(&pl, 0, sizeof(planner_t)); // Clear planner struct
@@ -213,12 +261,14 @@ void plan_reset ()
 
 void plan_discard_current_block ()
 {
-    if (block_buffer_head != block_buffer_tail) { // Discard non-empty buffer.
-        uint32_t block_index = plan_next_block_index(block_buffer_tail);
+    uint32_t block_tail = ring_index_load_own(block_buffer_tail);
+
+    if (ring_index_load(block_buffer_head) != block_tail) { // Discard non-empty buffer.
+        uint32_t block_index = plan_next_block_index(block_tail);
         // Push block_buffer_planned pointer, if encountered.
-        if (block_buffer_tail == block_buffer_planned)
+        if (block_tail == block_buffer_planned)
             block_buffer_planned = block_index;
-        block_buffer_tail = block_index;
+        ring_index_store(block_buffer_tail, block_index); // Release block to the planner.
     }
 }
 
@@ -233,21 +283,23 @@ plan_block_t *plan_get_system_motion_block ()
 // Returns address of first planner block, if available. Called by various main program functions.
 plan_block_t *plan_get_current_block ()
 {
-    return block_buffer_head == block_buffer_tail ? NULL : &block_buffer[block_buffer_tail];
+    uint32_t block_tail = ring_index_load_own(block_buffer_tail);
+
+    return ring_index_load(block_buffer_head) == block_tail ? NULL : &block_buffer[block_tail];
 }
 
 
 inline float plan_get_exec_block_exit_speed_sqr ()
 {
     uint32_t block_index = plan_next_block_index(block_buffer_tail);
-    return block_index == block_buffer_head ? 0.0f : block_buffer[block_index].entry_speed_sqr;
+    return block_index == ring_index_load(block_buffer_head) ? 0.0f : block_buffer[block_index].entry_speed_sqr;
 }
 
 
 // Returns the availability status of the block ring buffer. True, if full.
 bool plan_check_full_buffer ()
 {
-    return block_buffer_tail == next_buffer_head;
+    return ring_index_load(block_buffer_tail) == next_buffer_head;
 }
 
 
@@ -326,6 +378,9 @@ bool plan_buffer_line (float *target, plan_line_data_t *pl_data)
     #ifdef USE_LINE_NUMBERS
     block->line_number = pl_data->line_number;
     #endif
+    #ifdef PLANNER_EXIT_SPEED_HINTS
+    block->exit_speed_hint_sqr = pl_data->exit_speed * pl_data->exit_speed;
+    #endif
 
     // Compute and store initial move distance data.
 
@@ -468,12 +523,29 @@ bool plan_buffer_line (float *target, plan_line_data_t *pl_data)
         memcpy(pl.previous_unit_vec, unit_vec, sizeof(unit_vec)); // pl.previous_unit_vec[] = unit_vec[]
         memcpy(pl.position, target_steps, sizeof(target_steps)); // pl.position[] = target_steps[]
 
+        // Keep segment prep out until the new block is published and the plan recalculated.
+        st_prep_lock();
+
+      #ifdef PLANNER_EXIT_SPEED_HINTS
+        // The previous block was planned to exit at its hinted speed. If the new block can not be entered
+        // at that speed the hint was not valid for this machine, replan the whole buffer from its tail.
+        if (block_buffer_head != block_buffer_tail) {
+            float entry_speed_sqr = plan_compute_exit_speed_sqr(block) + 2.0f * block->acceleration * block->millimeters;
+            if (entry_speed_sqr > block->max_entry_speed_sqr)
+                entry_speed_sqr = block->max_entry_speed_sqr;
+            if (plan_compute_exit_speed_sqr(&block_buffer[plan_prev_block_index(block_buffer_head)]) > entry_speed_sqr)
+                block_buffer_planned = block_buffer_tail;
+        }
+      #endif
+
         // New block is all set. Update buffer head and next buffer head indices.
-        block_buffer_head = next_buffer_head;
-        next_buffer_head = plan_next_block_index(block_buffer_head);
+        ring_index_store(block_buffer_head, next_buffer_head); // Publish block to segment prep.
+        next_buffer_head = plan_next_block_index(next_buffer_head);
 
         // Finish up by recalculating the plan with the new block.
         planner_recalculate();
+
+        st_prep_unlock();
     }
 
     return true;
@@ -510,7 +582,14 @@ void plan_sync_position ()
 // Returns the number of available blocks are in the planner buffer.
 uint8_t plan_get_block_buffer_available ()
 {
-    return (uint8_t)(block_buffer_head >= block_buffer_tail ? ((BLOCK_BUFFER_SIZE - 1) - (block_buffer_head - block_buffer_tail)) : (block_buffer_tail - block_buffer_head - 1));
+    return (uint8_t)(block_buffer_head >= block_buffer_tail ? ((block_buffer_size - 1) - (block_buffer_head - block_buffer_tail)) : (block_buffer_tail - block_buffer_head - 1));
+}
+
+
+// Returns the number of usable blocks in the planner buffer.
+uint8_t plan_get_block_buffer_size ()
+{
+    return (uint8_t)(block_buffer_size - 1);
 }
 
 
@@ -519,9 +598,11 @@ uint8_t plan_get_block_buffer_available ()
 void plan_cycle_reinitialize ()
 {
     // Re-plan from a complete stop. Reset planner entry speeds and buffer planned pointer.
+    st_prep_lock();
     st_update_plan_block_parameters();
     block_buffer_planned = block_buffer_tail;
     planner_recalculate();
+    st_prep_unlock();
 }
 
 // Set feed overrides
@@ -533,7 +614,9 @@ void plan_feed_override (uint8_t feed_override, uint8_t rapid_override)
 	  sys.f_override = feed_override;
 	  sys.r_override = rapid_override;
 	  sys.report_ovr_counter = 0; // Set to report change immediately
+	  st_prep_lock();
 	  plan_update_velocity_profile_parameters();
 	  plan_cycle_reinitialize();
+	  st_prep_unlock();
 	}
 }
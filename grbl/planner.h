@@ -23,7 +23,8 @@
 #define planner_h
 
 
-// The number of linear motions that can be in the plan at any give time
+// The default number of linear motions that can be in the plan at any give time, the actual
+// number is set by $50 and limited by available memory.
 #ifndef BLOCK_BUFFER_SIZE
   #ifdef USE_LINE_NUMBERS
     #define BLOCK_BUFFER_SIZE 15
@@ -74,6 +75,9 @@ typedef struct {
   float max_junction_speed_sqr; // Junction entry speed limit based on direction vectors in (mm/min)^2
   float rapid_rate;             // Axis-limit adjusted maximum rate for this block direction in (mm/min)
   float programmed_rate;        // Programmed rate of this block (mm/min).
+  #ifdef PLANNER_EXIT_SPEED_HINTS
+    float exit_speed_hint_sqr;  // Host computed exit speed of the block in (mm/min)^2, zero if none. Copied from pl_line_data.
+  #endif
 
   #ifdef VARIABLE_SPINDLE
     // Stored spindle speed data used by spindle overrides and resuming methods.
@@ -87,6 +91,9 @@ typedef struct {
 typedef struct {
   float feed_rate;          // Desired feed rate for line motion. Value is ignored, if rapid motion.
   float spindle_speed;      // Desired spindle speed through line motion.
+  #ifdef PLANNER_EXIT_SPEED_HINTS
+    float exit_speed;       // Host computed exit speed hint (mm/min), zero if none.
+  #endif
   planner_cond_t condition; // Bitflag variable to indicate planner conditions. See defines above.
   #ifdef USE_LINE_NUMBERS
     int32_t line_number;    // Desired line number to report when executing.
@@ -94,6 +101,12 @@ typedef struct {
 } plan_line_data_t;
 
 
+// Returns the memory required for a block buffer of the given size
+uint32_t plan_buffer_size(uint32_t blocks);
+
+// Sets the block buffer to use, memory provided by the arena
+void plan_buffer_init(void *buffer, uint32_t blocks);
+
 // Initialize and reset the motion plan subsystem
 void plan_reset(); // Reset all
 //void plan_reset_buffer(); // Reset buffer only.
@@ -131,6 +144,9 @@ void plan_cycle_reinitialize();
 // Returns the number of available blocks in the planner buffer.
 uint8_t plan_get_block_buffer_available();
 
+// Returns the number of usable blocks in the planner buffer.
+uint8_t plan_get_block_buffer_size();
+
 // Returns the status of the block ring buffer. True, if buffer is full.
 bool plan_check_full_buffer();
 
@@ -21,7 +21,7 @@
 
 #include "grbl.h"
 
-static unsigned char buf[10];
+static CORE_STATE unsigned char buf[10];
 
 // void printIntegerInBase(unsigned long n, unsigned long base)
 // {
@@ -70,23 +70,98 @@ void print_uint8_base10 (uint8_t n)
 }
 
 
-void print_uint32_base10 (uint32_t n)
+// Two digits per division, halves the number of divisions needed to format a value.
+static const char digit_pairs[201] =
+    "00010203040506070809"
+    "10111213141516171819"
+    "20212223242526272829"
+    "30313233343536373839"
+    "40414243444546474849"
+    "50515253545556575859"
+    "60616263646566676869"
+    "70717273747576777879"
+    "80818283848586878889"
+    "90919293949596979899";
+
+// Scale factors for the supported number of decimal places.
+static const float decimal_scale[] = { 1.0f, 10.0f, 100.0f, 1000.0f, 10000.0f, 100000.0f };
+
+// Formats an unsigned value backwards from end, returns pointer to the first digit.
+static char *format_uint32 (char *end, uint32_t n)
 {
-    if (n == 0) {
-        serial_write('0');
-        return;
+    uint32_t q;
+
+    while (n >= 100) {
+        q = n / 100;
+        end -= 2;
+        memcpy(end, &digit_pairs[(n - q * 100) << 1], 2);
+        n = q;
     }
 
-    uint8_t i = 0;
+    if (n >= 10) {
+        end -= 2;
+        memcpy(end, &digit_pairs[n << 1], 2);
+    } else
+        *--end = '0' + n;
+
+    return end;
+}
+
+// Converts a float to a string with a fixed number of decimal places by scaling it to an integer,
+// which is then formatted two digits at a time. Returns pointer to the terminating null.
+// NOTE: Decimal places are limited to 5 and the scaled value must fit in 32 bits.
+static char *format_float (char *s, float n, uint_fast8_t decimal_places)
+{
+    char buf[12], *end = &buf[sizeof(buf)], *digits;
+    uint32_t a, q;
 
-    while (n > 0) {
-        buf[i++] = n % 10;
-        n /= 10;
+    if (n < 0.0f) {
+        *s++ = '-';
+        n = -n;
     }
 
-    while(i)
-        serial_write('0' + buf[--i]);
+    a = (uint32_t)(n * decimal_scale[decimal_places] + 0.5f); // Scale and round.
+
+    if (decimal_places) {
+
+        uint_fast8_t i = decimal_places;
+
+        // Generate decimals, zero padded to the decimal point.
+        digits = end;
+        while (i >= 2) {
+            q = a / 100;
+            digits -= 2;
+            memcpy(digits, &digit_pairs[(a - q * 100) << 1], 2);
+            a = q;
+            i -= 2;
+        }
+
+        if (i) {
+            q = a / 10;
+            *--digits = '0' + (a - q * 10);
+            a = q;
+        }
+
+        *--digits = '.';
+        digits = format_uint32(digits, a);
+    } else
+        digits = format_uint32(end, a);
+
+    a = end - digits;
+    memcpy(s, digits, a);
+    s += a;
+    *s = '\0';
+
+    return s;
+}
+
+
+void print_uint32_base10 (uint32_t n)
+{
+    char buf[11];
 
+    buf[10] = '\0';
+    serial_write_string(format_uint32(&buf[10], n));
 }
 
 
@@ -100,49 +175,32 @@ void printInteger (int32_t n)
 }
 
 
-// Convert float to string by immediately converting to a long integer, which contains
-// more digits than a float. Number of decimal places, which are tracked by a counter,
-// may be set by the user. The integer is then efficiently converted to a string.
+// Prints a float with a fixed number of decimal places.
 void printFloat (float n, uint8_t decimal_places)
 {
-    if (n < 0.0f) {
-        serial_write('-');
-        n = -n;
-    }
+    char buf[14];
 
-    uint32_t decimals = decimal_places;
-    while (decimals >= 2) { // Quickly convert values expected to be E0 to E-4.
-        n *= 100.0f;
-        decimals -= 2;
-    }
-
-    if (decimals)
-        n *= 10.0f;
-
-    n += 0.5f; // Add rounding factor. Ensures carryover through entire value.
-
-    // Generate digits backwards and store in string.
-    uint32_t i = 0, a = (long)n; // TODO: check for wrong cast?
-    buf[decimal_places] = '.'; // Place decimal point, even if decimal places are zero.
-
-    while(a > 0) {
-        if (i == decimal_places)
-            i++; // Skip decimal point location
-        buf[i++] = (a % 10) + '0'; // Get digit
-        a /= 10;
-    }
+    format_float(buf, n, decimal_places);
+    serial_write_string(buf);
+}
 
-    while (i < decimal_places) {
-        buf[i++] = '0'; // Fill in zeros to decimal point for (n < 1)
-    }
 
-    if (i == decimal_places) { // Fill in leading zero, if needed.
-        i++;
-        buf[i++] = '0';
+// Prints all axis values of a position vector in one pass, comma separated. Handles unit
+// conversion as for printFloat_CoordValue().
+void printFloat_CoordValues (float *axis_value)
+{
+    char buf[N_AXIS * 14], *s = buf;
+    float scale = settings.flags.report_inches ? INCH_PER_MM : 1.0f;
+    uint_fast8_t decimal_places = settings.flags.report_inches ? N_DECIMAL_COORDVALUE_INCH : N_DECIMAL_COORDVALUE_MM;
+    uint32_t idx;
+
+    for (idx = 0; idx < N_AXIS; idx++) {
+        if (idx)
+            *s++ = ',';
+        s = format_float(s, axis_value[idx] * scale, decimal_places);
     }
 
-    while(i)
-        serial_write(buf[--i]);
+    serial_write_string(buf);
 }
 
 
@@ -22,8 +22,6 @@
 #ifndef print_h
 #define print_h
 
-#define serial_write_string(s) hal.serial_write_string(s)
-
 void printInteger(int32_t n);
 
 void print_uint32_base10(uint32_t n);
@@ -42,6 +40,9 @@ void printFloat(float n, uint8_t decimal_places);
 //  - SettingValue: Handles all floating point settings values (always in mm.)
 void printFloat_CoordValue(float n);
 
+// Prints all axis values of a position vector, comma separated, as CoordValues.
+void printFloat_CoordValues(float *axis_value);
+
 void printFloat_RateValue(float n);
 
 void printFloat_SettingValue(float n);
@@ -30,21 +30,43 @@ typedef union {
                 comment_parentheses :1,
                 comment_semicolon   :1,
                 block_delete        :1,
-				unassigned          :4;
+                binary              :1,
+				unassigned          :3;
     };
 } line_flags_t;
 
-static uint8_t char_counter = 0;
-static char line[LINE_BUFFER_SIZE]; // Line to be executed. Zero-terminated.
-static char xcommand[LINE_BUFFER_SIZE];
+static CORE_STATE uint32_t char_counter = 0;
+static CORE_STATE int32_t line_sequence = -1; // Sequence number of last accepted sequenced line, -1 if none.
+static CORE_STATE uint32_t line_buffer_size;
+static CORE_STATE char *line = NULL;     // Line to be executed. Zero-terminated. Carved from the arena.
+static CORE_STATE char *xcommand = NULL; // Carved from the arena.
 
 static void protocol_exec_rt_suspend();
+static void protocol_auto_report();
+static status_code_t protocol_strip_sequence(int32_t *seq);
+
+// Returns the memory required for line buffers of the given size. Called by the arena.
+uint32_t protocol_buffer_size (uint32_t line_size)
+{
+    return line_size * 2; // line + xcommand
+}
+
+// Sets the line buffers, called by the arena on startup and reset.
+void protocol_buffer_init (char *buffer, uint32_t line_size)
+{
+    line = buffer;
+    xcommand = &buffer[line_size];
+    line_buffer_size = line_size;
+    char_counter = 0;
+    line[0] = xcommand[0] = '\0';
+}
 
 // add gcode to execute not originating from serial stream
 bool protocol_enqueue_gcode (char *gcode)
 {
 
-	bool ok = xcommand[0] == '\0' && (sys.state == STATE_IDLE || sys.state == STATE_JOG) && bit_isfalse(sys_rt_exec_state, EXEC_MOTION_CANCEL);
+	bool ok = xcommand != NULL && xcommand[0] == '\0' && strlen(gcode) < line_buffer_size &&
+	           (sys.state == STATE_IDLE || sys.state == STATE_JOG) && bit_isfalse(sys_rt_exec_state, EXEC_MOTION_CANCEL);
 
 	if(ok)
 		strcpy(xcommand, gcode);
@@ -87,17 +109,20 @@ bool protocol_main_loop()
     // This is also where Grbl idles while waiting for something to do.
     // ---------------------------------------------------------------------------------
 
-    int32_t c;
+    int32_t c, seq;
+    bool job_line = false;
     line_flags_t line_flags = {0};
-    status_code_t rstatus;
+    status_code_t rstatus, seq_status;
 
     xcommand[0] = '\0';
+    line_sequence = -1;
 
     for (;;) {
 
         // Process one line of incoming serial data, as the data becomes available. Performs an
         // initial filtering by removing spaces and comments and capitalizing all letters.
-        while((c = serial_read()) != SERIAL_NO_DATA) {
+        // When a job is running from storage its lines are read instead of the serial data.
+        while((c = (job_line = job_running()) ? job_read() : serial_read()) != SERIAL_NO_DATA) {
 
             if(c == CMD_RESET) {
 
@@ -108,8 +133,10 @@ bool protocol_main_loop()
 
             } else if ((c == '\n') || (c == '\r')) { // End of line reached
 
-                if(!protocol_execute_realtime()) // Runtime command check point.
-                    return !sys.exit;            // Bail to calling function upon system abort
+                // Runtime command check point. When validating or rebuilding the parser state of a job to resume
+                // only entered if a realtime command is pending.
+                if((!(sys.validating || job_resuming()) || sys_rt_exec_state || sys_rt_exec_alarm || sys_rt_exec_report) && !protocol_execute_realtime())
+                    return !sys.exit; // Bail to calling function upon system abort
 
                 line[char_counter] = '\0'; // Set string termination character.
 
@@ -117,33 +144,60 @@ bool protocol_main_loop()
                 report_echo_line_received(line);
               #endif
 
+                // Strip sequence number from sequenced lines.
+                seq = -1;
+                seq_status = line[0] == LINE_SEQUENCE_PREFIX ? protocol_strip_sequence(&seq) : Status_OK;
+
                 // Direct and execute one line of formatted input, and report status of execution.
                 if (line_flags.overflow) // Report line overflow error.
                     rstatus = Status_Overflow;
+                else if (seq_status != Status_OK) // Report sequence error, line is not executed.
+                    rstatus = seq_status;
                 else if (line[0] == '\0' || char_counter == 0) // Empty or comment line. For syncing purposes.
                     rstatus = Status_OK;
-                else if (line[0] == '$') // Grbl '$' system command
+                else if (job_uploading() && strcmp(line, "$FW")) // Line of file being uploaded to storage, $FW ends the upload.
+                    rstatus = job_write_line(line);
+                else if (line[0] == '$') { // Grbl '$' system command
+                    report_ack_flush(); // Keep command output after acknowledgements of previous lines.
                     rstatus = system_execute_line(line);
+                }
                 else if (sys.state & (STATE_ALARM | STATE_JOG)) // Everything else is gcode. Block if in alarm or jog mode.
                     rstatus = Status_SystemGClock;
+                else if (line[0] == 'O' || ngc_flowctrl_recording()) // O-word flow control or line of subroutine or loop.
+                    rstatus = ngc_flowctrl(line);
                 else  // Parse and execute g-code block.
                     rstatus = gc_execute_line(line);
 
-                report_status_message(rstatus);
+                if (sys.validating && line[0] != '$')
+                    validate_line(rstatus);
+
+                if (job_line) // Only the end of a job is reported.
+                    job_line_status(rstatus);
+                else if (seq >= 0)
+                    report_sequenced_status(rstatus, (uint16_t)seq);
+                else
+                    report_status_message(rstatus);
 
                 // Reset tracking data for next line.
                 line_flags.value = 0;
                 char_counter = 0;
 
+          #ifdef GCODE_BINARY_BLOCKS
+            } else if (line_flags.binary) {
+                // Binary block, data is copied unfiltered.
+                if (char_counter >= (line_buffer_size - 1))
+                    line_flags.overflow = on;
+                else
+                    line[char_counter++] = c;
+          #endif
             } else if (c <= ' ' || line_flags.value) {
                 // Throw away all whitepace, control characters, comment characters and overflow characters.
                 if (c == ')' && line_flags.comment_parentheses)
                     // End of '()' comment. Resume line.
                     line_flags.comment_parentheses = off;
-            } else if (c == '/') {
-                // Block delete. Ignore character.
-                // NOTE: If supported, would simply need to check the system if block delete is enabled.
-                line_flags.block_delete = char_counter == 0 && sys.block_delete_enabled;
+            } else if (c == '/' && char_counter == 0) {
+                // Block delete. Ignore character, elsewhere it is the division operator of expressions.
+                line_flags.block_delete = sys.block_delete_enabled;
             } else if (c == '(') {
                 // Enable comments flag and ignore all characters until ')' or EOL.
                 // NOTE: This doesn't follow the NIST definition exactly, but is good enough for now.
@@ -160,9 +214,15 @@ bool protocol_main_loop()
             // where, during a program, the system auto-cycle start will continue to execute
             // everything until the next '%' sign. This will help fix resuming issues with certain
             // functions that empty the planner buffer to execute its task on-time.
-            } else if (char_counter >= (LINE_BUFFER_SIZE - 1)) {
+            } else if (char_counter >= (line_buffer_size - 1)) {
                 // Detect line buffer overflow and set flag.
                 line_flags.overflow = on;
+          #ifdef GCODE_BINARY_BLOCKS
+            } else if (c == GC_BINARY_BLOCK_PREFIX) {
+                // Start of binary block, the rest of the line is not filtered.
+                line_flags.binary = on;
+                line[char_counter++] = c;
+          #endif
             } else
                 line[char_counter++] = (c >= 'a' && c <= 'z') ? c & 0x5F : c; // Upcase lowercase
         }
@@ -185,16 +245,49 @@ bool protocol_main_loop()
         // completed. In either case, auto-cycle start, if enabled, any queued moves.
         protocol_auto_cycle_start();
 
+        // Send coalesced acknowledgements, the host may be waiting for them.
+        report_ack_poll();
+
         if(!protocol_execute_realtime()) // Runtime command check point.
             return !sys.exit;            // Bail to main() program loop to reset system.
     }
 }
 
 
+// Sliding window streaming support. Parses and removes the sequence number prefix from the line,
+// the sequence number must be one more than the previous (wrapping after 65535) or 0 to restart
+// numbering. Returns Status_LineSequenceError for out of sequence lines, these are not executed.
+// NOTE: seq is set if the sequence number could be parsed, even if out of sequence.
+static status_code_t protocol_strip_sequence (int32_t *seq)
+{
+    uint32_t idx = 1, value = 0;
+
+    while (line[idx] >= '0' && line[idx] <= '9' && value <= 0xFFFF)
+        value = value * 10 + (line[idx++] - '0');
+
+    if (idx == 1 || value > 0xFFFF)
+        return Status_BadNumberFormat;
+
+    *seq = (int32_t)value;
+
+    if (value != 0 && line_sequence >= 0 && value != ((line_sequence + 1) & 0xFFFF))
+        return Status_LineSequenceError;
+
+    line_sequence = (int32_t)value;
+    char_counter -= idx;
+    memmove(line, &line[idx], char_counter + 1);
+
+    return Status_OK;
+}
+
+
 // Block until all buffered steps are executed or in a cycle state. Works with feed hold
 // during a synchronize call, if it should happen. Also, waits for clean cycle end.
 void protocol_buffer_synchronize ()
 {
+    // Acknowledge coalesced lines before waiting.
+    report_ack_flush();
+
     // If system is queued, ensure cycle resumes if the auto start flag is present.
     protocol_auto_cycle_start();
     while (protocol_execute_realtime() && (plan_get_current_block() || sys.state == STATE_CYCLE));
@@ -236,6 +329,10 @@ bool protocol_execute_realtime ()
     if (sys.suspend.value)
       protocol_exec_rt_suspend();
 
+    // Move lines parsed ahead to the planner buffer as it drains.
+    if (!sys.abort)
+      mc_queue_drain();
+
   #ifdef EMULATE_EEPROM
     if(sys.state == STATE_IDLE && settings_dirty.is_dirty)
         eeprom_emu_sync_physical();
@@ -271,6 +368,10 @@ void protocol_exec_rt_system ()
         }
     }
 
+    // Binary status reports are requested independently of text reports, both are sent if both are pending.
+    if (sys_rt_exec_report && ((rt_exec = system_clear_exec_reports()) & EXEC_STATUS_REPORT_BINARY))
+        report_realtime_status_binary();
+
     if (sys_rt_exec_state && (rt_exec = system_clear_exec_states())) { // Get and clear volatile sys_rt_exec_state atomically.
 
         // NOTE: not sure if some exec_state flags needs to preserved in some cases... If so must be set again from rt_exec later
@@ -429,10 +530,13 @@ void protocol_exec_rt_system ()
                 // NOTE: Motion and jog cancel both immediately return to idle after the hold completes.
                 if (sys.suspend.jog_cancel) {   // For jog cancel, flush buffers and sync positions.
                     sys.step_control.value = 0;
+                    mc_queue_reset();
+                    st_prep_lock();
                     plan_reset();
                     st_reset();
                     gc_sync_position();
                     plan_sync_position();
+                    st_prep_unlock();
                 }
                 if (sys.suspend.safety_door_ajar) { // Only occurs when safety door opens during jog.
                     sys.suspend.jog_cancel = off;
@@ -573,6 +677,9 @@ void protocol_exec_rt_system ()
 
     // End execute overrides.
 
+    if (settings.status_report_interval && hal.get_elapsed_ticks)
+        protocol_auto_report();
+
     // Reload step segment buffer
     if (sys.state & (STATE_CYCLE | STATE_HOLD | STATE_SAFETY_DOOR | STATE_HOMING | STATE_SLEEP| STATE_JOG))
         st_prep_buffer();
@@ -823,6 +930,26 @@ static void protocol_exec_rt_suspend ()
     }
 }
 
+// Pushes status reports without host request when enabled by $60. A full report is sent on each state
+// change, reports with changed fields only at the set interval while in a motion state.
+static void protocol_auto_report ()
+{
+    static CORE_STATE uint8_t last_state = 0xFF;
+    static CORE_STATE uint32_t last_report = 0;
+
+    uint32_t ms = hal.get_elapsed_ticks();
+
+    if (sys.state != last_state) {
+        last_state = sys.state;
+        last_report = ms;
+        report_realtime_status();
+    } else if ((sys.state & (STATE_HOMING | STATE_CYCLE | STATE_HOLD | STATE_JOG | STATE_SAFETY_DOOR)) &&
+                (ms - last_report) >= settings.status_report_interval) {
+        last_report = ms;
+        report_realtime_status_changes();
+    }
+}
+
 bool protocol_process_realtime (int32_t data) {
 
 	bool add = true;
@@ -845,6 +972,11 @@ bool protocol_process_realtime (int32_t data) {
 	        add = false;
 	        break;
 
+	    case CMD_STATUS_REPORT_BINARY: // Set as true
+	        system_set_exec_report_flag(EXEC_STATUS_REPORT_BINARY);
+	        add = false;
+	        break;
+
 	    case CMD_CYCLE_START: // Set as true
 	        system_set_exec_state_flag(EXEC_CYCLE_START);
 	        add = false;
@@ -22,7 +22,8 @@
 #ifndef protocol_h
 #define protocol_h
 
-// Line buffer size from the serial input stream to be executed.
+// Default line buffer size from the serial input stream to be executed. The actual size is set by $52
+// and limited by available memory.
 // NOTE: Not a problem except for extreme cases, but the line buffer size can be too small
 // and g-code blocks can get truncated. Officially, the g-code standards support up to 256
 // characters. In future versions, this will be increased, when we know how much extra
@@ -32,6 +33,16 @@
   #define LINE_BUFFER_SIZE 256
 #endif
 
+// Lines starting with this character followed by a sequence number (0-65535) are acknowledged
+// with the sequence number and the free serial RX buffer space, for sliding window streaming.
+#define LINE_SEQUENCE_PREFIX '@'
+
+// Returns the memory required for line buffers of the given size
+uint32_t protocol_buffer_size(uint32_t line_size);
+
+// Sets the line buffers to use, memory provided by the arena
+void protocol_buffer_init(char *buffer, uint32_t line_size);
+
 // Starts Grbl main loop. It handles all incoming characters from the serial port and executes
 // them as they complete. It is also responsible for finishing the initialization procedures.
 bool protocol_main_loop();
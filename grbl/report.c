@@ -53,13 +53,8 @@ inline static void report_util_gcode_modes_M () {
 
 // static void report_util_comment_line_feed() { serial_write(')'); report_util_line_feed(); }
 
-static void report_util_axis_values (float *axis_value) {
-    uint32_t idx;
-    for (idx = 0; idx < N_AXIS; idx++) {
-        printFloat_CoordValue(axis_value[idx]);
-        if (idx < (N_AXIS - 1))
-            serial_write(',');
-    }
+inline static void report_util_axis_values (float *axis_value) {
+    printFloat_CoordValues(axis_value);
 }
 
 static void report_util_uint8_setting (setting_type_t n, int val) {
@@ -69,6 +64,12 @@ static void report_util_uint8_setting (setting_type_t n, int val) {
  // report_util_setting_string(n);
 }
 
+static void report_util_uint_setting (setting_type_t n, uint32_t val) {
+    report_util_setting_prefix(n);
+    print_uint32_base10(val);
+    report_util_line_feed();
+}
+
 static void report_util_float_setting (setting_type_t n, float val, uint8_t n_decimal) {
     report_util_setting_prefix(n);
     printFloat(val,n_decimal);
@@ -77,6 +78,57 @@ static void report_util_float_setting (setting_type_t n, float val, uint8_t n_de
 }
 
 
+// Acknowledgement coalescing, enabled by $61. Successful lines are counted and acknowledged with a
+// single response when flushed, errors and other responses flush pending acknowledgements first.
+static CORE_STATE struct {
+    uint32_t count; // Number of lines pending acknowledgement.
+    int32_t seq;    // Sequence number of last line if sequenced, else -1.
+    uint32_t time;  // Time of the first pending line, if a tick counter is available.
+} ack_pending = {0, -1, 0};
+
+// Prints pending acknowledgements, ok:<lines> or for sequenced lines ok:<seq>,<rx free>.
+void report_ack_flush ()
+{
+    if (ack_pending.count) {
+        if (ack_pending.seq >= 0) {
+            serial_write_string("ok:");
+            print_uint32_base10((uint32_t)ack_pending.seq);
+            serial_write(',');
+            print_uint32_base10(serial_get_rx_buffer_available());
+        } else if (ack_pending.count == 1)
+            serial_write_string("ok");
+        else {
+            serial_write_string("ok:");
+            print_uint32_base10(ack_pending.count);
+        }
+        report_util_line_feed();
+        ack_pending.count = 0;
+        ack_pending.seq = -1;
+    }
+}
+
+// Flushes pending acknowledgements when ACK_COALESCE_TIMEOUT has elapsed, immediately if no tick
+// counter is available. Called from the main loop when no more input is available.
+void report_ack_poll ()
+{
+    if (ack_pending.count && (hal.get_elapsed_ticks == NULL || (hal.get_elapsed_ticks() - ack_pending.time) >= ACK_COALESCE_TIMEOUT))
+        report_ack_flush();
+}
+
+static void report_ack (int32_t seq)
+{
+    if (ack_pending.count && (ack_pending.seq < 0) != (seq < 0))
+        report_ack_flush(); // Do not mix plain and sequenced acknowledgements.
+
+    if (ack_pending.count++ == 0 && hal.get_elapsed_ticks)
+        ack_pending.time = hal.get_elapsed_ticks();
+
+    ack_pending.seq = seq;
+
+    if (ack_pending.count >= settings.ack_coalesce_lines)
+        report_ack_flush();
+}
+
 // Handles the primary confirmation protocol response for streaming interfaces and human-feedback.
 // For every incoming line, this method responds with an 'ok' for a successful command or an
 // 'error:'  to indicate some error event with the line or some critical system error during
@@ -88,18 +140,50 @@ void report_status_message (status_code_t status_code)
     switch(status_code) {
 
         case Status_OK: // STATUS_OK
-            serial_write_string("ok\r\n"); break;
+            if (settings.ack_coalesce_lines > 1)
+                report_ack(-1);
+            else
+                serial_write_string("ok\r\n");
+            break;
 
         default:
+            report_ack_flush();
             serial_write_string("error:");
             print_uint8_base10((uint8_t)status_code);
             report_util_line_feed();
     }
 }
 
+// Prints the response to a sequenced line, ok:<seq>,<rx free> or error:<code>,<seq>,<rx free>.
+// The sequence number acknowledges all lines up to and including it, the free serial RX buffer
+// space tells the host how much more it may send. This is in bytes as lines of any length are
+// stored back to back in the RX buffer, there are no line slots to report.
+void report_sequenced_status (status_code_t status_code, uint16_t seq)
+{
+    if (status_code == Status_OK && settings.ack_coalesce_lines > 1) {
+        report_ack(seq);
+        return;
+    }
+
+    report_ack_flush();
+
+    if (status_code == Status_OK)
+        serial_write_string("ok:");
+    else {
+        serial_write_string("error:");
+        print_uint8_base10((uint8_t)status_code);
+        serial_write(',');
+    }
+    print_uint32_base10(seq);
+    serial_write(',');
+    print_uint32_base10(serial_get_rx_buffer_available());
+    report_util_line_feed();
+}
+
 // Prints alarm messages.
 void report_alarm_message (alarm_code_t alarm_code)
 {
+    report_ack_flush();
     serial_write_string("ALARM:");
     print_uint8_base10((uint8_t)alarm_code);
     report_util_line_feed();
@@ -113,6 +197,7 @@ void report_alarm_message (alarm_code_t alarm_code)
 // is installed, the message number codes are less than zero.
 void report_feedback_message(message_code_t message_code)
 {
+    report_ack_flush();
 
     serial_write_string("[MSG:");
 
@@ -161,6 +246,10 @@ void report_feedback_message(message_code_t message_code)
         case Message_SleepMode:
             serial_write_string("Sleeping");
             break;
+
+        case Message_BufferSizesRestored:
+            serial_write_string("Buffer sizes restored");
+            break;
     }
     report_util_feedback_line_feed();
 }
@@ -169,12 +258,13 @@ void report_feedback_message(message_code_t message_code)
 // Welcome message
 void report_init_message ()
 {
+    report_ack_flush();
     serial_write_string("\r\nGrbl " GRBL_VERSION " ['$' for help]\r\n");
 }
 
 // Grbl help message
 void report_grbl_help () {
-    serial_write_string("[HLP:$$ $# $G $I $N $x=val $Nx=line $J=line $SLP $C $X $H $B ~ ! ? ctrl-x]\r\n");
+    serial_write_string("[HLP:$$ $# $G $I $N $x=val $Nx=line $J=line $SLP $C $V $F $X $H $B ~ ! ? ctrl-x]\r\n");
 }
 
 
@@ -219,8 +309,19 @@ void report_grbl_settings() {
     report_util_float_setting(Setting_PWMOffValue, settings.spindle_pwm_off_value, N_DECIMAL_SETTINGVALUE);
     report_util_float_setting(Setting_PWMMinValue, settings.spindle_pwm_min_value, N_DECIMAL_SETTINGVALUE);
     report_util_float_setting(Setting_PWMMaxValue, settings.spindle_pwm_max_value, N_DECIMAL_SETTINGVALUE);
-    // Print axis settings
     uint32_t idx, set_idx;
+    report_util_uint8_setting(Setting_PlannerBufferBlocks, settings.planner_buffer_blocks);
+    report_util_uint8_setting(Setting_SegmentBufferSize, settings.segment_buffer_size);
+    report_util_uint_setting(Setting_LineBufferSize, settings.line_buffer_size);
+    report_util_uint8_setting(Setting_ParseQueueSize, settings.parse_queue_size);
+    report_util_uint_setting(Setting_StatusReportInterval, settings.status_report_interval);
+    report_util_uint8_setting(Setting_AckCoalesceLines, settings.ack_coalesce_lines);
+#ifdef ADAPTIVE_MULTI_AXIS_STEP_SMOOTHING
+    report_util_uint8_setting(Setting_AmassLevels, settings.amass_levels);
+    for (idx = 0; idx < MAX_AMASS_LEVEL; idx++)
+        report_util_uint_setting((setting_type_t)(Setting_AmassCutoffBase + idx), settings.amass_cutoff[idx]);
+#endif
+    // Print axis settings
     uint8_t val = (uint8_t)Setting_AxisSettingsBase;
     for (set_idx = 0; set_idx < AXIS_N_SETTINGS; set_idx++) {
 
@@ -264,6 +365,8 @@ void report_grbl_settings() {
 // These values are retained until Grbl is power-cycled, whereby they will be re-zeroed.
 void report_probe_parameters ()
 {
+    report_ack_flush();
+
     // Report in terms of machine position.
     serial_write_string("[PRB:");
     float print_position[N_AXIS];
@@ -275,6 +378,83 @@ void report_probe_parameters ()
 }
 
 
+// Prints the validation summary when leaving check mode started with $V. Errors and soft limit
+// violations are listed by line number, counting from the first line received after $V.
+// [VAL:<lines>,<errors>,<soft limit violations>]
+// [VALERR:<line>,<status code>] and [VALSL:<line>], for the first VALIDATE_MAX_EVENTS of each
+// [VALBOX:<min>:<max>], bounding box of all motions in machine coordinates
+void report_validate_summary (validate_summary_t *summary)
+{
+    uint32_t idx;
+
+    report_ack_flush();
+
+    serial_write_string("[VAL:");
+    print_uint32_base10(summary->lines);
+    serial_write(',');
+    print_uint32_base10(summary->errors);
+    serial_write(',');
+    print_uint32_base10(summary->soft_limits);
+    report_util_feedback_line_feed();
+
+    for (idx = 0; idx < summary->errors && idx < VALIDATE_MAX_EVENTS; idx++) {
+        serial_write_string("[VALERR:");
+        print_uint32_base10(summary->error[idx].line);
+        serial_write(',');
+        print_uint8_base10((uint8_t)summary->error[idx].status);
+        report_util_feedback_line_feed();
+    }
+
+    for (idx = 0; idx < summary->soft_limits && idx < VALIDATE_MAX_EVENTS; idx++) {
+        serial_write_string("[VALSL:");
+        print_uint32_base10(summary->soft_limit_line[idx]);
+        report_util_feedback_line_feed();
+    }
+
+    serial_write_string("[VALBOX:");
+    report_util_axis_values(summary->min);
+    serial_write(':');
+    report_util_axis_values(summary->max);
+    report_util_feedback_line_feed();
+}
+
+
+void report_file (char *name, uint32_t size)
+{
+    serial_write_string("[FILE:");
+    serial_write_string(name);
+    serial_write(',');
+    print_uint32_base10(size);
+    report_util_feedback_line_feed();
+}
+
+
+// Prints the number of lines executed and the status of the last line, 0 if the job completed.
+void report_job_end (uint32_t lines, status_code_t status)
+{
+    report_ack_flush();
+
+    serial_write_string("[JOB:");
+    print_uint32_base10(lines);
+    serial_write(',');
+    print_uint8_base10((uint8_t)status);
+    report_util_feedback_line_feed();
+}
+
+
+// Prints the line a job is resumed at and the position moved to before it, in machine coordinates.
+void report_job_resume (uint32_t line, float *position)
+{
+    report_ack_flush();
+
+    serial_write_string("[RESUME:");
+    print_uint32_base10(line);
+    serial_write(':');
+    report_util_axis_values(position);
+    report_util_feedback_line_feed();
+}
+
+
 // Prints Grbl NGC parameters (coordinate offsets, probing)
 void report_ngc_parameters ()
 {
@@ -344,6 +524,11 @@ void report_gcode_modes ()
     report_util_gcode_modes_G();
     print_uint8_base10(94 - gc_state.modal.feed_mode);
 
+    if (is_canned_cycle(gc_state.modal.motion)) {
+        report_util_gcode_modes_G();
+        print_uint8_base10(gc_state.modal.retract_mode + 98);
+    }
+
     if (gc_state.modal.program_flow) {
         report_util_gcode_modes_M();
         switch (gc_state.modal.program_flow) {
@@ -467,6 +652,12 @@ void report_build_info(char *line)
   #ifdef ENABLE_PARKING_OVERRIDE_CONTROL
     serial_write('R');
   #endif
+  #ifdef GCODE_BINARY_BLOCKS
+    serial_write('B');
+  #endif
+  #ifdef PLANNER_EXIT_SPEED_HINTS
+    serial_write('X');
+  #endif
   #ifndef ENABLE_RESTORE_EEPROM_WIPE_ALL // NOTE: Shown when disabled.
     serial_write('*');
   #endif
@@ -491,7 +682,7 @@ void report_build_info(char *line)
 
   // NOTE: Compiled values, like override increments/max/min values, may be added at some point later.
   serial_write(',');
-  print_uint8_base10(BLOCK_BUFFER_SIZE - 1);
+  print_uint8_base10(plan_get_block_buffer_size());
   serial_write(',');
   print_uint32_base10(SERIAL_RX_BUFFER_SIZE);
   serial_write(',');
@@ -511,12 +702,26 @@ void report_echo_line_received (char *line)
 }
 
 
+// Last reported values of the intermittent status report fields, used by interval auto reports
+// to only include fields that has changed.
+static CORE_STATE struct {
+    bool valid;
+    float wco[N_AXIS];
+    uint8_t f_override;
+    uint8_t r_override;
+    uint8_t spindle_speed_ovr;
+    uint8_t accessories;
+    uint32_t pins;
+} report_last;
+
  // Prints real-time data. This function grabs a real-time snapshot of the stepper subprogram
  // and the actual location of the CNC machine. Users may change the following function to their
  // specific needs, but the desired real-time data report must be as short as possible. This is
  // requires as it minimizes the computational overhead and allows grbl to keep running smoothly,
  // especially during g-code programs with fast, short line segments and high frequency reports (5-20Hz).
-void report_realtime_status ()
+ // If changes_only is set the WCO, Ov, A and Pn fields are only included when changed since last
+ // reported, else they are included as set by the refresh counters.
+static void report_status (bool changes_only)
 {
 
     int32_t current_position[N_AXIS]; // Copy current state of the system position variable
@@ -580,7 +785,7 @@ void report_realtime_status ()
 
     uint32_t idx;
     float wco[N_AXIS];
-    if (!settings.status_report_mask.position_type || sys.report_wco_counter == 0) {
+    if (!settings.status_report_mask.position_type || sys.report_wco_counter == 0 || changes_only) {
         for (idx = 0; idx < N_AXIS; idx++) {
             // Apply work coordinate offsets and tool length offset to current position.
             wco[idx] = gc_state.coord_system[idx] + gc_state.coord_offset[idx] + (idx == TOOL_LENGTH_OFFSET_AXIS ? gc_state.tool_length_offset : 0.0f);
@@ -642,7 +847,9 @@ void report_realtime_status ()
 		control_signals_t ctrl_pin_state = system_control_get_state();
 		bool prb_pin_state = probe_get_state();
 
-		if (lim_pin_state.value | ctrl_pin_state.value | prb_pin_state | sys.block_delete_enabled) {
+		uint32_t pins = lim_pin_state.value | (ctrl_pin_state.value << 8) | (prb_pin_state << 16) | (sys.block_delete_enabled << 17);
+
+		if (changes_only ? (pins != report_last.pins || !report_last.valid) : pins != 0) {
 
 			serial_write_string("|Pn:");
 
@@ -684,15 +891,24 @@ void report_realtime_status ()
 			if(sys.block_delete_enabled)
 				serial_write('B');
 		}
+
+		report_last.pins = pins; // Absent field reports no active pins, so always known to the host.
     }
 
     bool report_overrides = sys.report_ovr_counter <= 0;
 
     if(settings.status_report_mask.work_coord_offset) {
 
-    	if (sys.report_wco_counter > 0)
+    	if (changes_only) {
+    		if (!report_last.valid || memcmp(wco, report_last.wco, sizeof(wco))) {
+				memcpy(report_last.wco, wco, sizeof(wco));
+				serial_write_string("|WCO:");
+				report_util_axis_values(wco);
+    		}
+    	} else if (sys.report_wco_counter > 0)
 			sys.report_wco_counter--;
 		else {
+			memcpy(report_last.wco, wco, sizeof(wco));
 			sys.report_wco_counter = sys.state & (STATE_HOMING | STATE_CYCLE | STATE_HOLD | STATE_JOG | STATE_SAFETY_DOOR)
 									  ? (REPORT_WCO_REFRESH_BUSY_COUNT - 1) // Reset counter for slow refresh
 									  : (REPORT_WCO_REFRESH_IDLE_COUNT - 1);
@@ -704,9 +920,27 @@ void report_realtime_status ()
 
     if(settings.status_report_mask.overrrides) {
 
-		if (sys.report_ovr_counter > 0)
+		spindle_state_t sp_state = spindle_get_state();
+		coolant_state_t cl_state = coolant_get_state();
+		uint8_t accessories = (sp_state.on ? (sp_state.ccw ? 2 : 1) : 0) | (cl_state.flood << 2) | (cl_state.mist << 3);
+		bool accessories_changed = accessories != report_last.accessories;
+
+		if (changes_only)
+			report_overrides = !report_last.valid || accessories_changed ||
+								sys.f_override != report_last.f_override ||
+								 sys.r_override != report_last.r_override ||
+								  sys.spindle_speed_ovr != report_last.spindle_speed_ovr;
+		else if (sys.report_ovr_counter > 0) {
 			sys.report_ovr_counter--;
-		else if(report_overrides) {
+			report_overrides = false;
+		}
+
+		if(report_overrides) {
+
+			report_last.f_override = sys.f_override;
+			report_last.r_override = sys.r_override;
+			report_last.spindle_speed_ovr = sys.spindle_speed_ovr;
+			report_last.accessories = accessories;
 
 			serial_write_string("|Ov:");
 			print_uint8_base10(sys.f_override);
@@ -715,9 +949,7 @@ void report_realtime_status ()
 			serial_write(',');
 			print_uint8_base10(sys.spindle_speed_ovr);
 
-			spindle_state_t sp_state = spindle_get_state();
-			coolant_state_t cl_state = coolant_get_state();
-			if (sp_state.on || cl_state.value || sys.report_ovr_counter < 0) {
+			if (accessories || sys.report_ovr_counter < 0 || (changes_only && accessories_changed)) {
 
 				serial_write_string("|A:");
 
@@ -738,6 +970,136 @@ void report_realtime_status ()
 		}
     }
 
+    if (changes_only)
+        report_last.valid = true;
+
     serial_write('>');
     report_util_line_feed();
 }
+
+void report_realtime_status ()
+{
+    report_status(false);
+}
+
+// Prints real-time data with the WCO, Ov, A and Pn fields only when changed, for interval auto reports.
+void report_realtime_status_changes ()
+{
+    report_status(true);
+}
+
+
+// Binary status frame. All multi-byte values are little-endian, floats are IEEE 754 single precision.
+//   Offset  Size        Content
+//   0       1           Sync byte, STATUS_FRAME_SYNC
+//   1       1           Frame format version, STATUS_FRAME_VERSION
+//   2       1           Payload length in bytes
+//   3       1           Machine state, sys.state bitmap (see STATE_ defines)
+//   4       1           Sub state, for Hold and Door as in the ASCII report, else 0
+//   5       1           Number of axes
+//   6       4*N_AXIS    Machine position in steps, sys_position
+//   +0      1           Planner blocks available
+//   +1      2           Serial RX buffer bytes available
+//   +3      4           Line number of executing block, 0 if none
+//   +7      4           Realtime feed rate, mm/min
+//   +11     4           Spindle speed, RPM
+//   +15     3           Feed, rapid and spindle speed overrides in percent
+//   +18     1           Limit pins, bit per axis
+//   +19     1           Control pins, control_signals_t bitmap
+//   +20     1           Flags: 0 - probe, 1 - block delete, 2 - spindle on, 3 - spindle ccw, 4 - flood, 5 - mist
+//   +21     2           CRC-16/CCITT of all preceding bytes, including sync byte
+// NOTE: Positions are raw step counts, hosts convert to mm by the axis steps/mm settings and add work
+//       offsets as reported by $#. No counters are updated, so ASCII reports are unaffected.
+#define STATUS_FRAME_SYNC 0xA5
+#define STATUS_FRAME_VERSION 1
+#define STATUS_FRAME_PAYLOAD (3 + 4 * N_AXIS + 21)
+
+static uint8_t *frame_put_uint16 (uint8_t *p, uint16_t value)
+{
+    *p++ = (uint8_t)value;
+    *p++ = (uint8_t)(value >> 8);
+
+    return p;
+}
+
+static uint8_t *frame_put_uint32 (uint8_t *p, uint32_t value)
+{
+    p = frame_put_uint16(p, (uint16_t)value);
+
+    return frame_put_uint16(p, (uint16_t)(value >> 16));
+}
+
+static uint8_t *frame_put_float (uint8_t *p, float value)
+{
+    uint32_t bits;
+
+    memcpy(&bits, &value, sizeof(uint32_t));
+
+    return frame_put_uint32(p, bits);
+}
+
+void report_realtime_status_binary ()
+{
+    int32_t current_position[N_AXIS]; // Copy current state of the system position variable
+    uint8_t frame[3 + STATUS_FRAME_PAYLOAD + 2], *p = frame, substate = 0, flags = 0;
+    uint32_t idx, line_number = 0;
+
+    memcpy(current_position, sys_position, sizeof(sys_position));
+
+    if (sys.state == STATE_HOLD)
+        substate = sys.suspend.hold_complete ? 0 : 1;
+    else if (sys.state == STATE_SAFETY_DOOR)
+        substate = sys.suspend.initiate_restore ? 3 : (sys.suspend.retract_complete ? (sys.suspend.safety_door_ajar ? 1 : 0) : 2);
+
+  #ifdef USE_LINE_NUMBERS
+    plan_block_t *cur_block = plan_get_current_block();
+    if (cur_block != NULL && cur_block->line_number > 0)
+        line_number = (uint32_t)cur_block->line_number;
+  #endif
+
+    spindle_state_t sp_state = spindle_get_state();
+    coolant_state_t cl_state = coolant_get_state();
+
+    if (probe_get_state())
+        flags |= bit(0);
+    if (sys.block_delete_enabled)
+        flags |= bit(1);
+    if (sp_state.on)
+        flags |= bit(2);
+    if (sp_state.ccw)
+        flags |= bit(3);
+    if (cl_state.flood)
+        flags |= bit(4);
+    if (cl_state.mist)
+        flags |= bit(5);
+
+    *p++ = STATUS_FRAME_SYNC;
+    *p++ = STATUS_FRAME_VERSION;
+    *p++ = STATUS_FRAME_PAYLOAD;
+    *p++ = sys.state;
+    *p++ = substate;
+    *p++ = N_AXIS;
+
+    for (idx = 0; idx < N_AXIS; idx++)
+        p = frame_put_uint32(p, (uint32_t)current_position[idx]);
+
+    *p++ = plan_get_block_buffer_available();
+    p = frame_put_uint16(p, serial_get_rx_buffer_available());
+    p = frame_put_uint32(p, line_number);
+    p = frame_put_float(p, st_get_realtime_rate());
+  #ifdef VARIABLE_SPINDLE
+    p = frame_put_float(p, sys.spindle_speed);
+  #else
+    p = frame_put_float(p, 0.0f);
+  #endif
+    *p++ = sys.f_override;
+    *p++ = sys.r_override;
+    *p++ = sys.spindle_speed_ovr;
+    *p++ = ((axes_signals_t)limits_get_state()).value;
+    *p++ = system_control_get_state().value;
+    *p++ = flags;
+
+    p = frame_put_uint16(p, calc_crc16(frame, p - frame));
+
+    serial_write_binary(frame, p - frame);
+}
@@ -25,6 +25,15 @@
 // Prints system status messages.
 void report_status_message(status_code_t status_code);
 
+// Prints the response to a sequenced line.
+void report_sequenced_status(status_code_t status_code, uint16_t seq);
+
+// Prints pending coalesced acknowledgements.
+void report_ack_flush();
+
+// Prints pending coalesced acknowledgements if the coalescing timeout has elapsed.
+void report_ack_poll();
+
 // Prints system alarm messages.
 void report_alarm_message(alarm_code_t alarm_code);
 
@@ -46,12 +55,30 @@ void report_echo_line_received(char *line);
 // Prints realtime status report
 void report_realtime_status();
 
+// Prints realtime status report, intermittent fields only included when changed since last reported.
+void report_realtime_status_changes();
+
+// Prints real-time data as a binary frame, requested by the CMD_STATUS_REPORT_BINARY realtime command.
+void report_realtime_status_binary();
+
 // Prints recorded probe position
 void report_probe_parameters();
 
 // Prints Grbl NGC parameters (coordinate offsets, probe)
 void report_ngc_parameters();
 
+// Prints the check mode validation summary
+void report_validate_summary(validate_summary_t *summary);
+
+// Prints a file of the job storage
+void report_file(char *name, uint32_t size);
+
+// Prints the end of a job run from storage
+void report_job_end(uint32_t lines, status_code_t status);
+
+// Prints the line a job is resumed at and the position moved to
+void report_job_resume(uint32_t line, float *position);
+
 // Prints current g-code parser mode state
 void report_gcode_modes();
 
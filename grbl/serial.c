@@ -0,0 +1,72 @@
+/*
+  serial.c - buffered output for reports and messages
+  Part of Grbl
+
+  Copyright (c) 2017 Terje Io
+
+  Grbl is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  Grbl is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with Grbl.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+/*
+  Output is formatted into a line buffer and passed to the driver a line at a time, via
+  hal.serial_write_buffer() if provided or else hal.serial_write_string(). The buffer is
+  flushed on each line feed and when full, so messages are never held back.
+  NOTE: Output is only generated by the main program, the buffer is not interrupt safe.
+*/
+
+#include "grbl.h"
+
+static CORE_STATE char tx_buffer[TX_LINE_BUFFER_SIZE + 1]; // + 1 for string terminator
+static CORE_STATE uint_fast16_t tx_length = 0;
+
+// Passes buffered output to the driver.
+void serial_flush ()
+{
+    if (tx_length) {
+        if (hal.serial_write_buffer)
+            hal.serial_write_buffer(tx_buffer, tx_length);
+        else {
+            tx_buffer[tx_length] = '\0';
+            hal.serial_write_string(tx_buffer);
+        }
+        tx_length = 0;
+    }
+}
+
+void serial_write (char c)
+{
+    tx_buffer[tx_length++] = c;
+
+    if (c == '\n' || tx_length == TX_LINE_BUFFER_SIZE)
+        serial_flush();
+}
+
+void serial_write_string (const char *s)
+{
+    char c;
+
+    while ((c = *s++))
+        serial_write(c);
+}
+
+// Writes binary data, bypasses the line buffer since data may contain null and line feed characters.
+void serial_write_binary (const uint8_t *data, uint16_t length)
+{
+    serial_flush();
+
+    if (hal.serial_write_buffer)
+        hal.serial_write_buffer((const char *)data, length);
+    else while (length--)
+        hal.serial_write(*data++);
+}
@@ -24,10 +24,24 @@
 
 #define SERIAL_NO_DATA -1
 
+// Size of the output line buffer, longer output is passed to the driver in chunks of this size.
+#ifndef TX_LINE_BUFFER_SIZE
+  #define TX_LINE_BUFFER_SIZE 128
+#endif
+
 #define SERIAL_RX_BUFFER_SIZE hal.rx_buffer_size
-#define serial_write(c) hal.serial_write(c)
 #define serial_read() hal.serial_read()
 #define serial_reset_read_buffer() hal.serial_reset_read_buffer()
 #define serial_get_rx_buffer_available() hal.serial_get_rx_buffer_available()
 
+// Buffered output, flushed to the driver on line feed or when the buffer is full.
+void serial_write(char c);
+void serial_write_string(const char *s);
+
+// Unbuffered output of binary data, any buffered text is flushed first.
+void serial_write_binary(const uint8_t *data, uint16_t length);
+
+// Passes any buffered output to the driver.
+void serial_flush();
+
 #endif
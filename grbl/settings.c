@@ -21,7 +21,18 @@
 
 #include "grbl.h"
 
-settings_t settings;
+CORE_STATE settings_t settings;
+
+#ifdef ADAPTIVE_MULTI_AXIS_STEP_SMOOTHING
+static const uint16_t amass_cutoff_defaults[6] = {
+    DEFAULT_AMASS_CUTOFF_1,
+    DEFAULT_AMASS_CUTOFF_2,
+    DEFAULT_AMASS_CUTOFF_3,
+    DEFAULT_AMASS_CUTOFF_4,
+    DEFAULT_AMASS_CUTOFF_5,
+    DEFAULT_AMASS_CUTOFF_6
+};
+#endif
 
 // Method to store startup lines into EEPROM
 void settings_store_startup_line (uint8_t n, char *line)
@@ -218,6 +229,18 @@ void settings_restore (uint8_t restore_flag) {
 	    settings.rpm_max = DEFAULT_SPINDLE_RPM_MAX;
 	    settings.rpm_min = DEFAULT_SPINDLE_RPM_MIN;
 
+	    settings.planner_buffer_blocks = BLOCK_BUFFER_SIZE;
+	    settings.segment_buffer_size = SEGMENT_BUFFER_SIZE;
+	    settings.line_buffer_size = LINE_BUFFER_SIZE;
+	    settings.parse_queue_size = PARSE_QUEUE_SIZE;
+	    settings.status_report_interval = DEFAULT_STATUS_REPORT_INTERVAL;
+	    settings.ack_coalesce_lines = DEFAULT_ACK_COALESCE_LINES;
+
+	  #ifdef ADAPTIVE_MULTI_AXIS_STEP_SMOOTHING
+	    settings.amass_levels = DEFAULT_AMASS_LEVELS > MAX_AMASS_LEVEL ? MAX_AMASS_LEVEL : DEFAULT_AMASS_LEVELS;
+	    memcpy(settings.amass_cutoff, amass_cutoff_defaults, sizeof(settings.amass_cutoff));
+	  #endif
+
 	    write_global_settings();
     }
 
@@ -500,7 +523,69 @@ status_code_t settings_store_global_setting (uint8_t parameter, float value) {
 //            	spindle_init();
             	break; // Re-initialize spindle pwm calibration
 
+            case Setting_PlannerBufferBlocks: // Reset to ensure change.
+                if (value < 4.0f || value > 255.0f || !arena_buffers_fit(int_value, settings.segment_buffer_size, settings.line_buffer_size, settings.parse_queue_size))
+                    return Status_SettingValueOutOfRange;
+                settings.planner_buffer_blocks = int_value;
+                break;
+
+            case Setting_SegmentBufferSize: // Reset to ensure change.
+                if (value < 3.0f || value > 255.0f || !arena_buffers_fit(settings.planner_buffer_blocks, int_value, settings.line_buffer_size, settings.parse_queue_size))
+                    return Status_SettingValueOutOfRange;
+                settings.segment_buffer_size = int_value;
+                break;
+
+            case Setting_LineBufferSize: // Reset to ensure change.
+                if (value < (float)MAX_STORED_LINE_LENGTH || value > 65535.0f ||
+                     !arena_buffers_fit(settings.planner_buffer_blocks, settings.segment_buffer_size, (uint32_t)value, settings.parse_queue_size))
+                    return Status_SettingValueOutOfRange;
+                settings.line_buffer_size = (uint16_t)value;
+                break;
+
+            case Setting_ParseQueueSize: // Reset to ensure change.
+                if (value > 255.0f || !arena_buffers_fit(settings.planner_buffer_blocks, settings.segment_buffer_size, settings.line_buffer_size, int_value))
+                    return Status_SettingValueOutOfRange;
+                settings.parse_queue_size = int_value;
+                break;
+
+            case Setting_StatusReportInterval:
+                if (value != 0.0f && hal.get_elapsed_ticks == NULL)
+                    return Status_SettingDisabled;
+                if (value > 65535.0f || (value != 0.0f && value < (float)MIN_STATUS_REPORT_INTERVAL))
+                    return Status_SettingValueOutOfRange;
+                settings.status_report_interval = (uint16_t)value;
+                break;
+
+            case Setting_AckCoalesceLines:
+                if (value > 255.0f)
+                    return Status_SettingValueOutOfRange;
+                report_ack_flush();
+                settings.ack_coalesce_lines = int_value;
+                break;
+
+            case Setting_AmassLevels: // Reset to ensure change.
+              #ifdef ADAPTIVE_MULTI_AXIS_STEP_SMOOTHING
+                if (int_value > hal.driver_cap.amass_level)
+                    return Status_SettingValueOutOfRange;
+                settings.amass_levels = int_value;
+              #else
+                return Status_SettingDisabled;
+              #endif
+                break;
+
             default:
+              #ifdef ADAPTIVE_MULTI_AXIS_STEP_SMOOTHING
+                if (parameter >= Setting_AmassCutoffBase && parameter < Setting_AmassCutoffBase + MAX_AMASS_LEVEL) {
+                    // Cutoff frequencies must be strictly decreasing with increasing level. Reset to ensure change.
+                    uint8_t level = parameter - Setting_AmassCutoffBase;
+                    if (value < 1.0f || value > 65535.0f ||
+                         (level > 0 && value >= (float)settings.amass_cutoff[level - 1]) ||
+                          (level < MAX_AMASS_LEVEL - 1 && value <= (float)settings.amass_cutoff[level + 1]))
+                        return Status_SettingValueOutOfRange;
+                    settings.amass_cutoff[level] = (uint16_t)value;
+                    break;
+                }
+              #endif
                 return Status_InvalidStatement;
         }
     }
@@ -27,7 +27,7 @@
 
 // Version of the EEPROM data. Will be used to migrate existing data from older versions of Grbl
 // when firmware is upgraded. Always stored in byte 0 of eeprom
-#define SETTINGS_VERSION 12  // NOTE: Check settings_reset() when moving to next version.
+#define SETTINGS_VERSION 17  // NOTE: Check settings_reset() when moving to next version.
 
 // Define settings restore bitflags.
 #define SETTINGS_RESTORE_DEFAULTS bit(0)
@@ -93,6 +93,14 @@ typedef enum {
     Setting_PWMOffValue = 34,
     Setting_PWMMinValue = 35,
     Setting_PWMMaxValue = 36,
+    Setting_AmassLevels = 37,
+    Setting_AmassCutoffBase = 40, // NOTE: One setting per AMASS level, 40 - 45.
+    Setting_PlannerBufferBlocks = 50,
+    Setting_SegmentBufferSize = 51,
+    Setting_LineBufferSize = 52,
+    Setting_ParseQueueSize = 53,
+    Setting_StatusReportInterval = 60,
+    Setting_AckCoalesceLines = 61,
     Setting_AxisSettingsBase = 100 // NOTE: Reserving settings values >= 100 for axis settings. Up to 255.
 } setting_type_t;
 
@@ -176,10 +184,20 @@ typedef struct {
     uint8_t pulse_delay_microseconds;
     reportmask_t status_report_mask; // Mask to indicate desired report data.
     settingflags_t flags;  // Contains default boolean settings
+    uint8_t planner_buffer_blocks; // Buffer sizes, carved from the arena on reset.
+    uint8_t segment_buffer_size;
+    uint16_t line_buffer_size;
+    uint8_t parse_queue_size;
+    uint16_t status_report_interval; // Auto report interval in milliseconds while in motion, 0 disables.
+    uint8_t ack_coalesce_lines;      // Max number of lines acknowledged by a single ok:N response, 0 or 1 disables.
+  #ifdef ADAPTIVE_MULTI_AXIS_STEP_SMOOTHING
+    uint8_t amass_levels;                    // Number of active AMASS levels, 0 disables AMASS.
+    uint16_t amass_cutoff[MAX_AMASS_LEVEL];  // Upper cutoff frequency for each AMASS level (Hz).
+  #endif
 
 } settings_t;
 
-extern settings_t settings;
+extern CORE_STATE settings_t settings;
 
 // Initialize the configuration subsystem (load settings from EEPROM)
 void settings_init();
@@ -187,6 +205,9 @@ void settings_init();
 // Helper function to clear and restore EEPROM defaults
 void settings_restore(uint8_t restore_flag);
 
+// Stores the global settings struct in EEPROM
+void write_global_settings();
+
 // A helper method to set new settings from command line
 status_code_t settings_store_global_setting(uint8_t parameter, float value);
 
@@ -26,6 +26,9 @@
 
 // Some useful constants.
 #define DT_SEGMENT (1.0f/(ACCELERATION_TICKS_PER_SECOND*60.0f)) // min/segment
+#ifdef ADAPTIVE_SEGMENT_TIME
+#define DT_SEGMENT_CRUISE (DT_SEGMENT*CRUISE_SEGMENT_TIME_MULTIPLIER) // min/segment
+#endif
 #define REQ_MM_INCREMENT_SCALAR 1.25f
 
 typedef enum {
@@ -61,7 +64,7 @@ typedef struct {
   #endif
 } st_block_t;
 
-static st_block_t st_block_buffer[SEGMENT_BUFFER_SIZE-1];
+static CORE_STATE st_block_t *st_block_buffer; // SEGMENT_BUFFER_SIZE-1 blocks, carved from the arena.
 
 // Primary stepper segment ring buffer. Contains small, short line segments for the stepper
 // algorithm to execute, which are "checked-out" incrementally from the first block in the
@@ -79,7 +82,8 @@ typedef struct {
   #endif
 } segment_t;
 
-static segment_t segment_buffer[SEGMENT_BUFFER_SIZE];
+static CORE_STATE segment_t *segment_buffer; // Carved from the arena.
+static CORE_STATE uint32_t segment_buffer_size;
 
 // Stepper ISR data struct. Contains the running data for the main stepper ISR.
 typedef struct {
@@ -113,30 +117,40 @@ typedef struct {
 	segment_t *exec_segment;  // Pointer to the segment being executed
 } stepper_t;
 
-static stepper_t st;
+static CORE_STATE stepper_t st;
 
 #ifdef ADAPTIVE_MULTI_AXIS_STEP_SMOOTHING
 typedef struct {
-	uint32_t level_1;
-	uint32_t level_2;
-	uint32_t level_3;
+	uint8_t levels;                   // Number of active AMASS levels, from settings.
+	uint8_t shift;                    // Bresenham data multiplier for prepped blocks, as a bit shift.
+	uint32_t cutoff[MAX_AMASS_LEVEL]; // Upper cutoff for each level in step timer cycles per step.
 } amass_t;
 
-static amass_t amass;
+static CORE_STATE amass_t amass;
 #endif
 
 // Stepper timer ticks per minute
-static float cycles_per_min;
+static CORE_STATE float cycles_per_min;
 
 // Step segment ring buffer indices
-static volatile uint32_t segment_buffer_tail;
-static uint32_t segment_buffer_head;
-static uint32_t segment_next_head;
+static CORE_STATE ring_index_t segment_buffer_tail; // Owned by the consumer (stepper ISR)
+static CORE_STATE ring_index_t segment_buffer_head; // Owned by the producer (segment prep)
+static CORE_STATE uint32_t segment_next_head;
+
+#ifdef STEPPER_PREP_INTERRUPT
+// Segment prep lock, nesting count. Held by segment prep while running and by the main program while
+// it updates planner blocks or prep data. A prep request arriving while locked is flagged pending
+// and executed when the lock is released.
+static CORE_STATE volatile uint_fast8_t prep_lock;
+static CORE_STATE volatile bool prep_pending;
+static CORE_STATE uint32_t prep_watermark; // Request prep when fewer segments than this are queued.
+#endif
 
-// Pointers for the step segment being prepped from the planner buffer. Accessed only by the
-// main program. Pointers may be planning segments or planner blocks ahead of what being executed.
-static plan_block_t *pl_block;     // Pointer to the planner block being prepped
-static st_block_t *st_prep_block;  // Pointer to the stepper block data being prepped
+// Pointers for the step segment being prepped from the planner buffer. Accessed only by segment
+// prep, which runs in the main program or, if enabled, in the low priority prep interrupt.
+// Pointers may be planning segments or planner blocks ahead of what being executed.
+static CORE_STATE plan_block_t *pl_block;     // Pointer to the planner block being prepped
+static CORE_STATE st_block_t *st_prep_block;  // Pointer to the stepper block data being prepped
 
 // Segment preparation data struct. Contains all the necessary information to compute new segments
 // based on the current executing planner block.
@@ -171,7 +185,7 @@ typedef struct {
   #endif
 } st_prep_t;
 
-static st_prep_t prep;
+static CORE_STATE st_prep_t prep;
 
 
 /*    BLOCK VELOCITY PROFILE DEFINITION
@@ -323,10 +337,12 @@ void stepper_driver_interrupt_handler (void)
     // If there is no step segment, attempt to pop one from the stepper buffer
     if (st.exec_segment == NULL) {
         // Anything in the buffer? If so, load and initialize next step segment.
-        if (segment_buffer_head != segment_buffer_tail) {
+        uint32_t segment_tail = ring_index_load_own(segment_buffer_tail);
+
+        if (ring_index_load(segment_buffer_head) != segment_tail) {
 
             // Initialize new step segment and load number of steps to execute
-            st.exec_segment = &segment_buffer[segment_buffer_tail];
+            st.exec_segment = &segment_buffer[segment_tail];
 
             // Initialize step segment timing per step and load number of steps to execute.
             hal.stepper_cycles_per_tick(st.exec_segment->cycles_per_tick);
@@ -480,13 +496,41 @@ void stepper_driver_interrupt_handler (void)
     if (st.step_count == 0) {
         // Segment is complete. Discard current segment and advance segment indexing.
         st.exec_segment = NULL;
-        segment_buffer_tail = segment_buffer_tail == (SEGMENT_BUFFER_SIZE - 1) ? 0 : segment_buffer_tail + 1;
+        uint32_t segment_tail = ring_index_load_own(segment_buffer_tail);
+        segment_tail = segment_tail == (segment_buffer_size - 1) ? 0 : segment_tail + 1;
+        ring_index_store(segment_buffer_tail, segment_tail);
+
+      #ifdef STEPPER_PREP_INTERRUPT
+        // Request segment buffer refill from the low priority interrupt when running low.
+        if (hal.stepper_prep_request) {
+            uint32_t segment_head = ring_index_load(segment_buffer_head);
+            if ((segment_head >= segment_tail ? segment_head - segment_tail : segment_buffer_size - segment_tail + segment_head) < prep_watermark)
+                hal.stepper_prep_request();
+        }
+      #endif
     }
 #ifdef DEBUGOUT
 //	debugout(0);
 #endif
 }
 
+// Returns the memory required for the step segment buffers of the given size. Called by the arena.
+uint32_t st_buffer_size (uint32_t segments)
+{
+    return segments * sizeof(segment_t) + (segments - 1) * sizeof(st_block_t);
+}
+
+// Sets the step segment buffers, called by the arena on startup and reset before st_reset().
+void st_buffer_init (void *buffer, uint32_t segments)
+{
+    segment_buffer = (segment_t *)buffer;
+    st_block_buffer = (st_block_t *)&segment_buffer[segments];
+    segment_buffer_size = segments;
+  #ifdef STEPPER_PREP_INTERRUPT
+    prep_watermark = SEGMENT_PREP_WATERMARK > segments - 1 ? segments - 1 : SEGMENT_PREP_WATERMARK;
+  #endif
+}
+
 // Reset and clear stepper subsystem variables
 void st_reset ()
 {
@@ -501,14 +545,20 @@ void st_reset ()
     segment_buffer_tail = 0;
     segment_buffer_head = 0; // empty = tail
     segment_next_head = 1;
+#ifdef STEPPER_PREP_INTERRUPT
+    // NOTE: prep_lock is left as is, the caller holds it while resetting.
+    prep_pending = false;
+#endif
 
 #ifdef ADAPTIVE_MULTI_AXIS_STEP_SMOOTHING
-    // TODO: move to driver?
     // AMASS_LEVEL0: Normal operation. No AMASS. No upper cutoff frequency. Starts at LEVEL1 cutoff frequency.
     // Defined as step timer frequency / Cutoff frequency in Hz
-    amass.level_1 = hal.f_step_timer / 8000;
-    amass.level_2 = hal.f_step_timer / 4000;
-    amass.level_3 = hal.f_step_timer / 2000;
+    // NOTE: Level count and cutoff frequencies are settings, they take effect here.
+    amass.levels = settings.amass_levels > hal.driver_cap.amass_level ? hal.driver_cap.amass_level : settings.amass_levels;
+    amass.shift = amass.levels ? amass.levels : 1; // Keep a minimum of 2x Bresenham resolution when AMASS is off.
+    uint_fast8_t idx;
+    for (idx = 0; idx < amass.levels; idx++)
+        amass.cutoff[idx] = hal.f_step_timer / settings.amass_cutoff[idx];
 #endif
 
 	cycles_per_min = (float)hal.f_step_timer * 60.f;
@@ -521,18 +571,38 @@ void st_reset ()
 // Called by planner_recalculate() when the executing block is updated by the new plan.
 void st_update_plan_block_parameters ()
 {
+    st_prep_lock();
     if (pl_block != NULL) { // Ignore if at start of a new block.
         prep.recalculate_flags.recalculate = on;
         pl_block->entry_speed_sqr = prep.current_speed * prep.current_speed; // Update entry speed.
         pl_block = NULL; // Flag st_prep_segment() to load and check active velocity profile.
     }
+    st_prep_unlock();
 }
 
+#ifdef STEPPER_PREP_INTERRUPT
+
+// Blocks segment prep from the low priority interrupt while the main program updates planner
+// blocks or segment prep data. Calls may be nested, each must be paired with st_prep_unlock().
+void st_prep_lock ()
+{
+    prep_lock++;
+}
+
+// Releases the segment prep lock, requests a refill if one was deferred while locked.
+void st_prep_unlock ()
+{
+    if (--prep_lock == 0 && prep_pending && hal.stepper_prep_request)
+        hal.stepper_prep_request();
+}
+
+#endif
+
 
 // Increments the step segment buffer block data ring buffer.
 inline static uint8_t st_next_block_index (uint8_t block_index)
 {
-     return block_index == (SEGMENT_BUFFER_SIZE - 2) ? 0 : block_index + 1;
+     return block_index == (segment_buffer_size - 2) ? 0 : block_index + 1;
 }
 
 
@@ -587,13 +657,17 @@ inline static uint8_t st_next_block_index (uint8_t block_index)
    Currently, the segment buffer conservatively holds roughly up to 40-50 msec of steps.
    NOTE: Computation units are in steps, millimeters, and minutes.
 */
+#ifdef STEPPER_PREP_INTERRUPT
+static void st_prep_segments()
+#else
 void st_prep_buffer()
+#endif
 {
     // Block step prep buffer, while in a suspend state and there is no suspend motion to execute.
     if (sys.step_control.end_motion)
       return;
 
-    while (segment_buffer_tail != segment_next_head) { // Check if we need to fill the buffer.
+    while (ring_index_load(segment_buffer_tail) != segment_next_head) { // Check if we need to fill the buffer.
 #ifdef DEBUGOUT
 	debugout(1);
 #endif
@@ -636,14 +710,14 @@ void st_prep_buffer()
                   } while(idx);
                   st_prep_block->step_event_count = (pl_block->step_event_count << 1);
                 #else
-                  // With AMASS enabled, simply bit-shift multiply all Bresenham data by the max AMASS
+                  // With AMASS enabled, simply bit-shift multiply all Bresenham data by the max active AMASS
                   // level, such that we never divide beyond the original data anywhere in the algorithm.
                   // If the original data is divided, we can lose a step from integer roundoff.
                   do {
                       idx--;
-                      st_prep_block->steps[idx] = pl_block->steps[idx] << MAX_AMASS_LEVEL;
+                      st_prep_block->steps[idx] = pl_block->steps[idx] << amass.shift;
                   } while(idx);
-                  st_prep_block->step_event_count = pl_block->step_event_count << MAX_AMASS_LEVEL;
+                  st_prep_block->step_event_count = pl_block->step_event_count << amass.shift;
                 #endif
 
                 // Initialize segment buffer data for generating the segments.
@@ -767,7 +841,7 @@ void st_prep_buffer()
         }
 
         // Initialize new segment
-        segment_t *prep_segment = &segment_buffer[segment_buffer_head];
+        segment_t *prep_segment = &segment_buffer[ring_index_load_own(segment_buffer_head)];
 
         // Set new segment to point to the current segment data block.
         prep_segment->st_block_index = prep.st_block_index;
@@ -786,7 +860,13 @@ void st_prep_buffer()
           the end of planner block (typical) or mid-block at the end of a forced deceleration,
           such as from a feed hold.
         */
+      #ifdef ADAPTIVE_SEGMENT_TIME
+        // Constant speed does not need the time resolution of a ramp, extend the segment time when cruising.
+        bool cruise_segment = prep.ramp_type == Ramp_Cruise;
+        float dt_max = cruise_segment ? DT_SEGMENT_CRUISE : DT_SEGMENT; // Maximum segment time
+      #else
         float dt_max = DT_SEGMENT; // Maximum segment time
+      #endif
         float dt = 0.0f; // Initialize segment time
         float time_var = dt_max; // Time worker variable
         float mm_var; // mm - Distance worker variable
@@ -863,6 +943,15 @@ void st_prep_buffer()
 
             dt += time_var; // Add computed ramp time to total segment time.
 
+          #ifdef ADAPTIVE_SEGMENT_TIME
+            // End an extended segment when leaving the cruise state, the ramp that follows is to be
+            // traced with normal length segments.
+            if (cruise_segment && prep.ramp_type != Ramp_Cruise) {
+                cruise_segment = false;
+                dt_max = dt > DT_SEGMENT ? dt : DT_SEGMENT;
+            }
+          #endif
+
             if (dt < dt_max)
                 time_var = dt_max - dt;// **Incomplete** At ramp junction.
             else {
@@ -945,10 +1034,12 @@ void st_prep_buffer()
       #ifdef ADAPTIVE_MULTI_AXIS_STEP_SMOOTHING
         // Compute step timing and multi-axis smoothing level.
         // NOTE: AMASS overdrives the timer with each level, so only one prescalar is required.
-        if (cycles < amass.level_1)
-            prep_segment->amass_level = 0;
-        else {
-            prep_segment->amass_level = cycles < amass.level_2 ? 1 : (cycles < amass.level_3 ? 2 : 3);
+        // NOTE: The step event count is the dominant axis step count, so the level is selected from
+        //       the step rate of the dominant axis.
+        prep_segment->amass_level = 0;
+        while (prep_segment->amass_level < amass.levels && cycles >= amass.cutoff[prep_segment->amass_level])
+            prep_segment->amass_level++;
+        if (prep_segment->amass_level) {
             cycles >>= prep_segment->amass_level;
             prep_segment->n_step <<= prep_segment->amass_level;
         }
@@ -957,8 +1048,8 @@ void st_prep_buffer()
         prep_segment->cycles_per_tick = cycles;
 
         // Segment complete! Increment segment buffer indices, so stepper ISR can immediately execute it.
-        segment_buffer_head = segment_next_head;
-        segment_next_head = segment_next_head == (SEGMENT_BUFFER_SIZE - 1) ? 0 : segment_next_head + 1;
+        ring_index_store(segment_buffer_head, segment_next_head);
+        segment_next_head = segment_next_head == (segment_buffer_size - 1) ? 0 : segment_next_head + 1;
 
         // Update the appropriate planner and segment data.
         pl_block->millimeters = mm_remaining;
@@ -995,6 +1086,29 @@ debugout(0);
     }
 }
 
+#ifdef STEPPER_PREP_INTERRUPT
+
+// Reloads the step segment buffer, called from the main program and from the low priority
+// prep interrupt. If locked the refill is deferred until the lock is released.
+// NOTE: A request flagged pending just as the holder completes may be lost, the stepper ISR
+//       will then request a new refill when the next segment completes.
+void st_prep_buffer()
+{
+    if (prep_lock) {
+        prep_pending = true;
+        return;
+    }
+
+    prep_lock++;
+    do {
+        prep_pending = false;
+        st_prep_segments();
+    } while (prep_pending);
+    prep_lock--;
+}
+
+#endif
+
 
 // Called by realtime status reporting to fetch the current speed being executed. This value
 // however is not exactly the current speed, but the speed computed in the last step segment
@@ -22,6 +22,7 @@
 #ifndef stepper_h
 #define stepper_h
 
+// Default step segment buffer size, the actual size is set by $51 and limited by available memory.
 #ifndef SEGMENT_BUFFER_SIZE
   #define SEGMENT_BUFFER_SIZE 6
 #endif
@@ -35,6 +36,12 @@ void st_wake_up();
 // Immediately disables steppers
 void st_go_idle();
 
+// Returns the memory required for step segment buffers of the given size
+uint32_t st_buffer_size(uint32_t segments);
+
+// Sets the step segment buffers to use, memory provided by the arena
+void st_buffer_init(void *buffer, uint32_t segments);
+
 // Reset the stepper subsystem variables
 void st_reset();
 
@@ -50,6 +57,17 @@ void st_prep_buffer();
 // Called by planner_recalculate() when the executing block is updated by the new plan.
 void st_update_plan_block_parameters();
 
+#ifdef STEPPER_PREP_INTERRUPT
+// Blocks segment prep from the prep interrupt while planner blocks or prep data are updated.
+void st_prep_lock();
+
+// Releases the segment prep lock, must be paired with st_prep_lock().
+void st_prep_unlock();
+#else
+#define st_prep_lock()
+#define st_prep_unlock()
+#endif
+
 // Called by realtime status reporting if realtime rate reporting is enabled in config.h.
 float st_get_realtime_rate();
 
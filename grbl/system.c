@@ -117,23 +117,33 @@ status_code_t system_execute_line (char *line)
             break;
 
         case 'C' : // Set check g-code mode [IDLE/CHECK]
+        case 'V' : // Set check g-code mode with validation summary [IDLE/CHECK]
             if (line[2] != '\0')
                 retval = Status_InvalidStatement;
             // Perform reset when toggling off. Check g-code mode should only work if Grbl
             // is idle and ready, regardless of alarm locks. This is mainly to keep things
             // simple and consistent.
             else if (sys.state == STATE_CHECK_MODE) {
+                if (sys.validating)
+                    report_validate_summary(validate_get_summary());
                 mc_reset();
                 report_feedback_message(Message_Disabled);
             }
             else if (sys.state)  // Requires idle mode.
                 retval = Status_IdleError;
             else {
-                sys.state = STATE_CHECK_MODE;
+                if (line[1] == 'V')
+                    validate_start();
+                else
+                    sys.state = STATE_CHECK_MODE;
                 report_feedback_message(Message_Enabled);
             }
             break;
 
+        case 'F' : // Job storage, list, upload, run or delete files
+            retval = job_execute_command(line);
+            break;
+
         case 'X' : // Disable alarm lock [ALARM]
             if (line[2] != '\0' )
                 retval = Status_InvalidStatement;
@@ -37,6 +37,9 @@
 #define EXEC_MOTION_CANCEL  bit(6) // bitmask 01000000
 #define EXEC_SLEEP          bit(7) // bitmask 10000000
 
+// Report executor bit map, for report requests that do not fit in the system executor flags above.
+#define EXEC_STATUS_REPORT_BINARY bit(0) // bitmask 00000001
+
 // Define system state bit map. The state variable primarily tracks the individual functions
 // of Grbl to manage each without overlapping. It is also used as a messaging flag for
 // critical events.
@@ -63,7 +66,8 @@ typedef enum {
     Message_ProgramEnd = 8,
     Message_RestoreDefaults = 9,
     Message_SpindleRestore = 10,
-    Message_SleepMode = 11
+    Message_SleepMode = 11,
+    Message_BufferSizesRestored = 12
 } message_code_t;
 
 // Alarm executor codes. Valid values (1-255). Zero is reserved.
@@ -150,6 +154,7 @@ typedef struct {
     spindle_stop_t spindle_stop_ovr;    // Tracks spindle stop override states
     int8_t report_ovr_counter;          // Tracks when to add override data to status reports.
     uint8_t report_wco_counter;         // Tracks when to add work coordinate offset data to status reports.
+    bool validating;                    // Check mode with validation summary, see $V.
   #ifdef ENABLE_PARKING_OVERRIDE_CONTROL
     parking_override_t override_ctrl;   // Tracks override control states.
   #endif
@@ -158,15 +163,16 @@ typedef struct {
   #endif
 } system_t;
 
-extern system_t sys;
+extern CORE_STATE system_t sys;
 
 // NOTE: These position variables may need to be declared as volatiles, if problems arise.
-extern int32_t sys_position[N_AXIS];      // Real-time machine (aka home) position vector in steps.
-extern int32_t sys_probe_position[N_AXIS]; // Last probe position in machine coordinates and steps.
+extern CORE_STATE int32_t sys_position[N_AXIS];      // Real-time machine (aka home) position vector in steps.
+extern CORE_STATE int32_t sys_probe_position[N_AXIS]; // Last probe position in machine coordinates and steps.
 
-extern volatile uint8_t sys_probe_state;   // Probing stue.  Used to coordinate the probing cycle with stepper ISR.
-extern volatile uint8_t sys_rt_exec_state;   // Global realtime executor bitflag variable for state management. See EXEC bitmasks.
-extern volatile uint8_t sys_rt_exec_alarm;   // Global realtimeate val executor bitflag variable for setting various alarms.
+extern CORE_STATE volatile uint8_t sys_probe_state;   // Probing stue.  Used to coordinate the probing cycle with stepper ISR.
+extern CORE_STATE volatile uint8_t sys_rt_exec_state;   // Global realtime executor bitflag variable for state management. See EXEC bitmasks.
+extern CORE_STATE volatile uint8_t sys_rt_exec_alarm;   // Global realtimeate val executor bitflag variable for setting various alarms.
+extern CORE_STATE volatile uint8_t sys_rt_exec_report;  // Global realtime executor bitflag variable for report requests. See EXEC bitmasks.
 
 // Returns bitfield of control pin states, organized by CONTROL_PIN_INDEX. (1=triggered, 0=not triggered).
 #define system_control_get_state() hal.system_control_get_state()
@@ -201,6 +207,8 @@ bool system_check_travel_limits(float *target);
 #define system_clear_exec_states() hal.set_value_atomic(&sys_rt_exec_state, 0)
 #define system_set_exec_alarm(code) hal.set_value_atomic(&sys_rt_exec_alarm, (uint8_t)(code))
 #define system_clear_exec_alarm() hal.set_value_atomic(&sys_rt_exec_alarm, 0)
+#define system_set_exec_report_flag(mask) hal.set_bits_atomic(&sys_rt_exec_report, (mask))
+#define system_clear_exec_reports() hal.set_value_atomic(&sys_rt_exec_report, 0)
 
 void control_interrupt_handler (control_signals_t signals);
 
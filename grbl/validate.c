@@ -0,0 +1,91 @@
+/*
+  validate.c - check mode job validation summary
+  Part of Grbl
+
+  Copyright (c) 2017 Terje Io
+
+  Grbl is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  Grbl is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with Grbl.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+/*
+  Validation is check mode for whole jobs. Lines are parsed as fast as they arrive: the main loop
+  only enters the realtime system when a realtime command is pending, and motions are recorded for
+  the summary instead of being passed to the planner. Soft limit violations are counted instead of
+  raising an alarm, so a single run reports all of them. The summary is printed when leaving.
+*/
+
+#include "grbl.h"
+
+static CORE_STATE validate_summary_t summary;
+static CORE_STATE bool soft_limit_exceeded; // A motion of the line in progress exceeds machine travel.
+
+void validate_start ()
+{
+    float position[N_AXIS];
+    uint32_t idx = N_AXIS;
+
+    memset(&summary, 0, sizeof(validate_summary_t));
+    soft_limit_exceeded = false;
+
+    system_convert_array_steps_to_mpos(position, sys_position);
+    do {
+        idx--;
+        summary.min[idx] = summary.max[idx] = position[idx];
+    } while(idx);
+
+    sys.state = STATE_CHECK_MODE;
+    sys.validating = true;
+}
+
+void validate_line (status_code_t status)
+{
+    summary.lines++;
+
+    // Arcs and canned cycles are many motions, a line is counted once.
+    if (soft_limit_exceeded) {
+        soft_limit_exceeded = false;
+        if (summary.soft_limits < VALIDATE_MAX_EVENTS)
+            summary.soft_limit_line[summary.soft_limits] = summary.lines;
+        summary.soft_limits++;
+    }
+
+    if (status != Status_OK) {
+        if (summary.errors < VALIDATE_MAX_EVENTS) {
+            summary.error[summary.errors].line = summary.lines;
+            summary.error[summary.errors].status = status;
+        }
+        summary.errors++;
+    }
+}
+
+void validate_motion (float *target)
+{
+    uint32_t idx = N_AXIS;
+
+    do {
+        idx--;
+        if (target[idx] < summary.min[idx])
+            summary.min[idx] = target[idx];
+        else if (target[idx] > summary.max[idx])
+            summary.max[idx] = target[idx];
+    } while(idx);
+
+    if (settings.flags.soft_limit_enable && system_check_travel_limits(target))
+        soft_limit_exceeded = true;
+}
+
+validate_summary_t *validate_get_summary ()
+{
+    return &summary;
+}
@@ -0,0 +1,56 @@
+/*
+  validate.h - check mode job validation summary
+  Part of Grbl
+
+  Copyright (c) 2017 Terje Io
+
+  Grbl is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  Grbl is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with Grbl.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef validate_h
+#define validate_h
+
+// Number of errors and soft limit violations listed in the summary, all are counted.
+#ifndef VALIDATE_MAX_EVENTS
+  #define VALIDATE_MAX_EVENTS 8
+#endif
+
+typedef struct {
+    uint32_t line;
+    status_code_t status;
+} validate_error_t;
+
+typedef struct {
+    uint32_t lines;       // Lines received, excluding '$' commands.
+    uint32_t errors;      // Lines rejected with an error.
+    uint32_t soft_limits; // Lines with motions exceeding machine travel, if soft limits are enabled.
+    validate_error_t error[VALIDATE_MAX_EVENTS];
+    uint32_t soft_limit_line[VALIDATE_MAX_EVENTS];
+    float min[N_AXIS];    // Bounding box of all motions in machine coordinates,
+    float max[N_AXIS];    // including the start position.
+} validate_summary_t;
+
+// Enters check mode with the validation summary enabled.
+void validate_start (void);
+
+// Records the result of a line, called from the main loop for all but '$' commands.
+void validate_line (status_code_t status);
+
+// Records a motion, called from mc_line() instead of planning it.
+void validate_motion (float *target);
+
+// Returns the validation summary.
+validate_summary_t *validate_get_summary (void);
+
+#endif